@@ -0,0 +1,31 @@
+#ifndef BALANCE_LOG_H
+#define BALANCE_LOG_H
+
+#include "server.h"
+#include <stdatomic.h>
+
+/* --- BALANCE LOG MODE (transactions.db is the source of truth for balances) --- */
+// In log mode a deposit or transfer changes the balance in memory and appends to
+// transactions.db; accounts.db is no longer rewritten per operation. A checkpointer
+// folds the new log rows into balances.ckpt every BANK_CHECKPOINT_SEC, and startup
+// loads the checkpoint and replays the log past it.
+//   BANK_BALANCE_MODE    "log", or "inplace" (default: balances rewritten in accounts.db)
+//   BANK_CHECKPOINT_SEC  checkpoint period in log mode (default 30)
+// Starting in place mode after a log mode run recovers the balances into accounts.db
+// and removes the checkpoint.
+#define BALANCE_MODE_ENV "BANK_BALANCE_MODE"
+#define CHECKPOINT_SEC_ENV "BANK_CHECKPOINT_SEC"
+#define CHECKPOINT_SEC_DEFAULT 30
+
+typedef struct {
+    _Atomic uint64_t checkpoints;       // balances.ckpt files written
+    _Atomic uint64_t rows_replayed;     // Log rows folded in (startup + checkpoints)
+    _Atomic uint64_t log_rows;          // Rows covered by the newest checkpoint
+} balance_log_stats_t;
+
+int balance_log_init(void);         // After init_account_map and init_txn_log (server only)
+void balance_log_shutdown(void);    // Final checkpoint; balances copied back into accounts.db
+int balance_log_enabled(void);
+const balance_log_stats_t *balance_log_stats(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "utils.h"
+#include <stdatomic.h>
+
+/* --- BUFFER POOL (Shared in-memory pages over the record tables) --- */
+// Server-wide cache of fixed-size pages. A page holds a whole number of records, so a
+// record never straddles two pages. Updates modify the cached page and mark it dirty;
+// a flusher thread writes dirty pages back every BANK_BUFFER_POOL_FLUSH_MS, and clock
+// eviction writes a dirty victim back before reusing its frame.
+//   BANK_BUFFER_POOL_KB        pool size in KB (default 4096; 0 disables the pool)
+//   BANK_BUFFER_POOL_FLUSH_MS  flusher period (default 100)
+#define BUFFER_POOL_ENV "BANK_BUFFER_POOL_KB"
+#define BUFFER_POOL_FLUSH_ENV "BANK_BUFFER_POOL_FLUSH_MS"
+#define BUFFER_POOL_KB_DEFAULT 4096
+#define BUFFER_POOL_FLUSH_MS_DEFAULT 100
+#define BP_PAGE_SIZE 4096
+#define BP_PARTITIONS 16        // Independently locked slices of the pool
+
+typedef struct {
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t evictions;
+    _Atomic uint64_t writebacks;    // Pages written by the flusher or by eviction
+    _Atomic uint64_t bypasses;      // Accesses served from the file (no free frame)
+} bp_stats_t;
+
+int buffer_pool_init(void);         // Sizes the pool and starts the flusher (server only)
+void buffer_pool_shutdown(void);    // Stops the flusher, writes every dirty page back; tables then use the files
+int buffer_pool_enabled(void);
+const bp_stats_t *buffer_pool_stats(void);
+
+// Copy up to 'max' rows starting at 'row' out of one page; returns the rows copied (0 past
+// EOF). When every frame is pinned, both calls fall through to the file.
+int bp_read_rows(db_table_id_t table, size_t rec_size, uint64_t row, size_t max, void *out);
+// Overwrite one existing row in its cached page and mark the page dirty; 1 on success
+int bp_write_row(db_table_id_t table, size_t rec_size, uint64_t row, const void *rec);
+// Write one existing row to the file (not synced), then into its cached page; on a
+// failed write the page keeps the old row. 1 on success
+int bp_write_row_through(db_table_id_t table, size_t rec_size, uint64_t row, const void *rec);
+
+#endif
@@ -6,11 +6,17 @@
 #include "server.h" 
 
 /* --- CUSTOMER MODULE INTERFACE (Atomic financial operations) --- */
+typedef struct {
+    uint32_t to_id;
+    money_t amount;
+} batch_transfer_item_t;
+
 int view_balance(uint32_t user_id, char *resp_msg, size_t resp_sz);
-int deposit_money(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz);
-int withdraw_money(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz);
-int transfer_funds(uint32_t from_id, uint32_t to_id, double amount, char *resp_msg, size_t resp_sz);
-int apply_loan(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz);
+int deposit_money(uint32_t user_id, money_t amount, char *resp_msg, size_t resp_sz);
+int withdraw_money(uint32_t user_id, money_t amount, char *resp_msg, size_t resp_sz);
+int transfer_funds(uint32_t from_id, uint32_t to_id, money_t amount, char *resp_msg, size_t resp_sz);
+int batch_transfer(uint32_t from_id, const batch_transfer_item_t *items, int count, char *resp_msg, size_t resp_sz);
+int apply_loan(uint32_t user_id, money_t amount, char *resp_msg, size_t resp_sz);
 int view_loan_status(uint32_t user_id, char *resp_msg, size_t resp_sz);
 int add_feedback(uint32_t user_id, const char *msg, char *resp_msg, size_t resp_sz);
 int view_feedback_status(uint32_t user_id, char *resp_msg, size_t resp_sz);
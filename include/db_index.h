@@ -0,0 +1,92 @@
+#ifndef DB_INDEX_H
+#define DB_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/* --- IN-MEMORY HASH INDEX (Open addressing, linear probing) --- */
+// Maps a non-zero numeric key (user_id, loan_id, ...) to a file offset.
+typedef struct {
+    uint64_t key;       // 0 marks an empty slot
+    int64_t value;      // Offset of the record in its .db file
+} id_index_slot_t;
+
+typedef struct {
+    id_index_slot_t *slots;
+    size_t capacity;    // Always a power of two
+    size_t count;
+} id_index_t;
+
+int id_index_init(id_index_t *idx, size_t capacity_hint);
+void id_index_free(id_index_t *idx);
+int64_t id_index_get(const id_index_t *idx, uint64_t key);     // -1 if absent
+int id_index_put(id_index_t *idx, uint64_t key, int64_t value); // Insert or overwrite
+int id_index_del(id_index_t *idx, uint64_t key);                // 1 if it was present
+
+/* --- STRING KEY INDEX (username -> offset, ...) --- */
+typedef struct {
+    uint64_t hash;
+    char *key;          // NULL = empty, STR_INDEX_TOMBSTONE = deleted, owned copy otherwise
+    int64_t value;
+} str_index_slot_t;
+
+typedef struct {
+    str_index_slot_t *slots;
+    size_t capacity;    // Always a power of two
+    size_t count;       // Live keys
+    size_t used;        // Live keys + tombstones (drives growth)
+} str_index_t;
+
+extern char str_index_tombstone[];
+#define STR_INDEX_TOMBSTONE str_index_tombstone
+
+int str_index_init(str_index_t *idx, size_t capacity_hint);
+void str_index_free(str_index_t *idx);
+int64_t str_index_get(const str_index_t *idx, const char *key);     // -1 if absent
+int str_index_put(str_index_t *idx, const char *key, int64_t value); // Insert or overwrite
+int str_index_del(str_index_t *idx, const char *key);                // 1 if removed
+
+/* --- MULTI-VALUE INDEX (status -> loan ids, user_id -> loan ids, ...) --- */
+// Any key (0 included) maps to a set of ids kept in ascending order.
+typedef struct {
+    uint64_t *ids;
+    size_t count;
+    size_t capacity;
+} id_list_t;
+
+typedef struct {
+    id_index_t lookup;  // key + 1 -> position in 'lists'
+    id_list_t *lists;
+    size_t count;
+    size_t capacity;
+} id_multi_index_t;
+
+void id_multi_free(id_multi_index_t *idx);
+const id_list_t *id_multi_get(const id_multi_index_t *idx, uint64_t key);  // NULL if none
+int id_multi_add(id_multi_index_t *idx, uint64_t key, uint64_t id);
+int id_multi_del(id_multi_index_t *idx, uint64_t key, uint64_t id);      // 1 if removed
+
+/* --- BLOOM FILTER (string keys; "maybe present" or "certainly absent") --- */
+// Bits are set with an atomic OR, so probes need no lock and can run while one writer
+// (serialised by the caller) adds keys. The filter never shrinks: it is sized for
+// 'capacity' keys and rebuilt bigger by its owner once that many were added.
+#define BLOOM_BITS_PER_KEY 16
+#define BLOOM_HASHES 6
+#define BLOOM_MIN_KEYS 1024
+
+typedef struct {
+    _Atomic uint64_t *words;
+    uint64_t bits;              // Always a power of two
+    size_t capacity;            // Keys it was sized for
+    size_t count;               // Keys added
+    _Atomic uint64_t set_bits;  // Bits turned on so far (drives the expected rate)
+} bloom_filter_t;
+
+int bloom_init(bloom_filter_t *f, size_t capacity_hint);
+void bloom_free(bloom_filter_t *f);
+void bloom_add(bloom_filter_t *f, const char *key);
+int bloom_may_contain(const bloom_filter_t *f, const char *key);   // 0 = never added
+double bloom_false_positive_rate(const bloom_filter_t *f);         // Expected, from the fill
+
+#endif
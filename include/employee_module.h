@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include "utils.h" 
 
 /* --- EMPLOYEE MODULE INTERFACE (Customer/Loan Mgmt) --- */
@@ -12,5 +13,6 @@ int approve_reject_loan(uint64_t loan_id, const char *action, uint32_t emp_id, c
 int view_assigned_loans(uint32_t emp_id, char *resp_msg, size_t resp_sz);
 int process_loans(char *resp_msg, size_t resp_sz);
 int view_customer_transactions(uint32_t custId, char *resp_msg, size_t resp_sz);
+int view_customer_transactions_range(uint32_t custId, time_t from, time_t to, char *resp_msg, size_t resp_sz);
 
 #endif
\ No newline at end of file
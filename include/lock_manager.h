@@ -0,0 +1,31 @@
+#ifndef LOCK_MANAGER_H
+#define LOCK_MANAGER_H
+
+#include <stdint.h>
+
+/* --- IN-PROCESS LOCK MANAGER (Shared/exclusive locks keyed by table + record id) --- */
+// Record ids hash onto a fixed set of stripes per table, so unrelated records can
+// occasionally share a lock; never hold two records of the same table at once except
+// through lm_lock_record_set.
+#define LOCK_MANAGER_TABLES 16     // At least DB_TABLE_COUNT (checked in utils.h)
+#define LOCK_MANAGER_STRIPES 256
+
+typedef enum {
+    LOCK_SHARED = 0,
+    LOCK_EXCLUSIVE
+} lock_mode_t;
+
+// Whole-table lock (scans in shared mode; appends and batch rewrites exclusive)
+void lm_lock_table(unsigned table, lock_mode_t mode);
+void lm_unlock_table(unsigned table, lock_mode_t mode);
+
+// Record lock (also holds the table in the matching intention mode)
+void lm_lock_record(unsigned table, uint64_t record_id, lock_mode_t mode);
+void lm_unlock_record(unsigned table, uint64_t record_id, lock_mode_t mode);
+
+// Several records of one table, taken in a fixed global order (deadlock-free; ids that
+// repeat or share a stripe are locked once)
+void lm_lock_record_set(unsigned table, const uint64_t *record_ids, int count, lock_mode_t mode);
+void lm_unlock_record_set(unsigned table, const uint64_t *record_ids, int count, lock_mode_t mode);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* --- MONEY (Fixed-point int64 minor units: 1 == 0.01) --- */
+// Balances, amounts and the protocol all use money_t; text is always "units.cc".
+typedef int64_t money_t;
+
+#define MONEY_SCALE 100
+#define MONEY_STR_LEN 32            // Fits any money_t as text
+#define MONEY_MAX (INT64_MAX / 2)   // Headroom so a single add cannot overflow
+
+// Exact decimal parse ("12", "12.5", "-0.05"); 0 on junk, more than two decimals or overflow
+static inline int money_parse(const char *s, money_t *out) {
+    int neg = 0;
+    money_t units = 0, cents = 0;
+    if (*s == '-' || *s == '+') neg = (*s++ == '-');
+    if (*s < '0' || *s > '9') {
+        if (*s != '.' || s[1] < '0' || s[1] > '9') return 0;
+    }
+    for (; *s >= '0' && *s <= '9'; s++) {
+        if (units > (MONEY_MAX / MONEY_SCALE - (*s - '0')) / 10) return 0;
+        units = units * 10 + (*s - '0');
+    }
+    if (*s == '.') {
+        s++;
+        for (int digits = 0; *s >= '0' && *s <= '9'; s++, digits++) {
+            if (digits == 2) return 0;
+            cents += (*s - '0') * (digits == 0 ? 10 : 1);
+        }
+    }
+    if (*s != '\0') return 0;
+    *out = (units * MONEY_SCALE + cents) * (neg ? -1 : 1);
+    return 1;
+}
+
+// Same text as "%.2f" of the decimal value
+static inline const char *money_format(money_t m, char *buf, size_t sz) {
+    uint64_t mag = m < 0 ? (uint64_t)0 - (uint64_t)m : (uint64_t)m;
+    snprintf(buf, sz, "%s%llu.%02llu", m < 0 ? "-" : "",
+             (unsigned long long)(mag / MONEY_SCALE), (unsigned long long)(mag % MONEY_SCALE));
+    return buf;
+}
+
+// Rounds a legacy floating-point amount to minor units (db migrations only)
+static inline money_t money_from_double(double v) {
+    return (money_t)(v * MONEY_SCALE + (v < 0 ? -0.5 : 0.5));
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef RECORD_CACHE_H
+#define RECORD_CACHE_H
+
+#include "utils.h"
+#include <stdatomic.h>
+
+/* --- RECORD CACHE (Decoded rows of cached tables, LRU per shard) --- */
+// Server-wide read-through cache of whole records keyed by (table, key), in front of the
+// buffer pool. The table engine fills it on a read under the shared record lock and
+// replaces or drops an entry on every in-place write under the exclusive record lock,
+// so a cached record is never older than the file row. users.db is the only cached table.
+//   BANK_RECORD_CACHE_ENTRIES  records kept (default 4096; 0 disables the cache)
+#define RECORD_CACHE_ENV "BANK_RECORD_CACHE_ENTRIES"
+#define RECORD_CACHE_ENTRIES_DEFAULT 4096
+#define RECORD_CACHE_SHARDS 16          // Independently locked LRU lists
+#define RECORD_CACHE_MAX_REC 1024       // Largest record it holds (TABLE_MAX_REC_SIZE)
+
+typedef struct {
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t evictions;         // Least recently used records dropped for room
+    _Atomic uint64_t invalidations;     // Records dropped because a write could not refresh them
+} record_cache_stats_t;
+
+int record_cache_init(void);            // Sizes the cache (server only)
+int record_cache_enabled(void);
+const record_cache_stats_t *record_cache_stats(void);
+
+// Copy the cached record for 'key' into 'out'; 1 on a hit
+int rc_get(db_table_id_t table, uint64_t key, size_t rec_size, void *out);
+// Insert or refresh the record for 'key' (the caller holds its record lock)
+void rc_put(db_table_id_t table, uint64_t key, size_t rec_size, const void *rec);
+void rc_invalidate(db_table_id_t table, uint64_t key);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef REDO_LOG_H
+#define REDO_LOG_H
+
+#include "server.h"
+
+/* --- REDO LOG (Crash-safe multi-file operations) --- */
+// A transfer or loan approval touches accounts.db, loans.db and transactions.db. Its
+// full change set is made durable in redo.db before any of it is applied; the server
+// then writes the images, marks the entry APPLIED, commits the log rows and marks it
+// DONE. At startup redo_recover() rewrites every image its record does not hold yet
+// (judged by the record's redo stamp), adds missing log rows for entries that are not
+// DONE, and drops entries that were never fully written. Syncing follows BANK_TXN_FSYNC
+// ("none" skips it).
+#define REDO_TRUNCATE_BYTES (1 << 20)   // redo.db is emptied past this once nothing is in flight
+
+// Stamps are the low 32 bits of a seq, compared as serial numbers (0 = never stamped)
+static inline int redo_stamp_older(uint32_t stamp, uint32_t seq) {
+    return stamp == 0 || (int32_t)(stamp - seq) < 0;
+}
+
+typedef struct {
+    const account_rec_t *accounts;
+    int account_count;
+    const loan_rec_t *loan;     // NULL if no loan changes
+    const txn_rec_t *rows;
+    int row_count;
+} redo_change_t;
+
+// Make the change set durable; 0 on failure (then nothing may be applied)
+int redo_commit(const redo_change_t *change, uint64_t *seq);
+void redo_mark(uint64_t seq, redo_rec_kind_t state);     // REDO_APPLIED, then REDO_DONE
+// Past REDO_TRUNCATE_BYTES with nothing in flight: sync accounts.db and loans.db, then
+// start redo.db over (call with no record locks held)
+void redo_checkpoint(void);
+// An APPLIED entry whose log rows failed to commit ('log_rows': the log size before the
+// attempt). It stays in flight, so redo.db is kept, and redo_checkpoint() retries the
+// rows that did not reach the log and marks it DONE
+void redo_defer_rows(uint64_t seq, const txn_rec_t *rows, int count, uint64_t log_rows);
+
+// Startup, after the indexes and account map and before the buffer pool and balance log:
+// returns the entries finished, or -1
+int redo_recover(void);
+
+#endif
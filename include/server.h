@@ -13,6 +13,7 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <fcntl.h>
+#include "money.h"
 
 /* --- SERVER CONFIGURATION --- */
 #define DEFAULT_PORT 9090 
@@ -29,6 +30,7 @@
 #define MAX_LNAME_LEN 64
 #define MAX_EMAIL_LEN 64
 #define MAX_PHONE_LEN 16
+#define MAX_BATCH_TRANSFER_ITEMS 64     // (destination, amount) pairs per BATCH_TRANSFER
 
 /* --- FILE PATHS (Persistence Layer) --- */
 #define DB_DIR "./db"         
@@ -37,6 +39,26 @@
 #define TRANSACTIONS_DB_FILE DB_DIR"/transactions.db"
 #define LOANS_DB_FILE DB_DIR"/loans.db"
 #define FEEDBACK_DB_FILE DB_DIR"/feedback.db"
+#define TXN_POSTINGS_DB_FILE DB_DIR"/txn_postings.db"   // Per-account chains through transactions.db
+#define TXN_SEGMENTS_DB_FILE DB_DIR"/txn_segments.db"   // Footers of the sealed transactions.db segments
+#define TXN_ARCHIVE_DB_FILE DB_DIR"/txn_archive.db"     // Compressed blocks of archived segments
+#define TXN_ARCHIVE_INDEX_FILE DB_DIR"/txn_archive.idx"  // One entry per txn_archive.db block
+#define FEEDBACK_WATERMARK_FILE DB_DIR"/feedback_review.db" // First feedback row that may be unreviewed
+#define META_DB_FILE DB_DIR"/meta.db"                   // On-disk schema version
+#define BALANCE_CKPT_FILE DB_DIR"/balances.ckpt"        // Balance log mode: balances as of a log row
+#define REDO_DB_FILE DB_DIR"/redo.db"                   // Multi-file operations, logged before they are applied
+#define DB_LOCK_FILE DB_DIR"/server.lock"              // Held by the running server (one per db/)
+
+/* --- SCHEMA VERSIONS (meta.db) --- */
+// 1: balances/amounts stored as double (no meta.db)
+// 2: balances/amounts stored as money_t minor units
+// 3: account/loan records carry a redo stamp in what was struct padding (zeroed on upgrade)
+#define DB_META_MAGIC 0x4154454Du       // "META"
+#define DB_SCHEMA_VERSION 3
+
+/* --- RECORD ADDRESSING --- */
+#define USER_ID_BASE 1001           // First user_id (== account_id) handed out
+#define ACCOUNT_SLOT_EMPTY 0        // account_id of an unused slot in accounts.db
 
 /* --- ENUMS (Core Logic States) --- */
 typedef enum {  
@@ -55,6 +77,13 @@ typedef enum {
     LOAN_APPROVED, 
     LOAN_REJECTED 
 } loan_status_t;
+typedef enum {
+    TXN_DEPOSIT = 1,        // Legacy narration "deposit"
+    TXN_WITHDRAW,           // "withdraw"
+    TXN_TRANSFER_OUT,       // "transfer_out"
+    TXN_TRANSFER_IN,        // "transfer_in"
+    TXN_LOAN_DEPOSIT        // "loan_deposit"
+} txn_type_t;
 
 /* --- DATA STRUCTURES (Binary File Records) --- */
 typedef struct {
@@ -74,21 +103,23 @@ typedef struct {
 typedef struct {
     uint32_t account_id;      
     uint32_t user_id;         
-    double balance;
+    money_t balance;
     status_t active;          
+    uint32_t redo_seq;        // Low 32 bits of the last redo entry written into it (0 = none)
 } account_rec_t;
 typedef struct {
     uint64_t txn_id;
     uint32_t from_account;    
     uint32_t to_account;      
-    double amount;
+    money_t amount;
     time_t timestamp;
-    char narration[128];
-} txn_rec_t;
+    txn_type_t type;
+} txn_rec_t;                // Decoded form handed to/from the transaction log
 typedef struct {
     uint64_t loan_id;
     uint32_t user_id;
-    double amount;
+    uint32_t redo_seq;        // As in account_rec_t
+    money_t amount;
     loan_status_t status;
     uint32_t assigned_to;     
     time_t applied_at;
@@ -103,6 +134,156 @@ typedef struct {
     char action_taken[256];
     time_t submitted_at;
 } feedback_rec_t;
+typedef struct {
+    uint32_t magic;
+    uint32_t schema_version;
+} db_meta_t;                // meta.db
+
+/* --- CHECKSUMS (FNV-1a over on-disk records) --- */
+// For files that are replaced or appended whole (balances.ckpt, redo.db, the archive)
+#define FNV1A_INIT 0xcbf29ce484222325ull
+static inline uint64_t fnv1a_update(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/* --- TRANSACTIONS.DB FORMAT (Compact v1: header + 32-byte rows) --- */
+// The header is one row long, so row N lives at (N + 1) * TXN_DISK_REC_SIZE.
+#define TXN_FILE_MAGIC 0x4E585442u      // "BTXN"
+#define TXN_FILE_VERSION 1
+#define TXN_DISK_REC_SIZE 32
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t base_time;          // Row timestamps are stored relative to this
+    uint32_t record_size;
+    uint8_t reserved[12];
+} txn_file_header_t;
+typedef struct {
+    uint64_t txn_id;
+    uint32_t from_account;
+    uint32_t to_account;
+    money_t amount;
+    uint32_t time_delta;        // Seconds since base_time
+    uint8_t type;               // txn_type_t
+    uint8_t reserved[3];
+} txn_disk_rec_t;
+
+/* --- TXN_SEGMENTS.DB FORMAT (Time-partitioned transactions.db) --- */
+// The log is cut into segments of consecutive rows: one per UTC day, capped at
+// TXN_SEGMENT_MAX_ROWS. Entry N is the footer of sealed segment N; the rows after the
+// last sealed segment form the open one. A date-range or per-account scan checks the
+// footers and skips every segment that cannot hold a match.
+#define TXN_SEGMENT_MAX_ROWS 65536
+#define TXN_SEGMENT_SECONDS 86400
+#define TXN_SEGMENT_BLOOM_BITS 2048     // Account bloom filter, 3 probes per account
+typedef struct {
+    uint64_t first_row;         // transactions.db row of the segment's first row
+    uint32_t rows;
+    uint32_t reserved;
+    int64_t min_time, max_time;
+    uint64_t min_txn_id, max_txn_id;
+    uint8_t bloom[TXN_SEGMENT_BLOOM_BITS / 8];  // Every from/to account in the segment
+} txn_segment_t;
+
+static inline uint32_t txn_segment_bloom_probe(uint32_t account_id, int k) {
+    uint64_t h = (uint64_t)account_id * 0x9E3779B97F4A7C15ull;
+    return (uint32_t)(h >> (64 - 11 * (k + 1))) % TXN_SEGMENT_BLOOM_BITS;
+}
+
+static inline void txn_segment_bloom_add(txn_segment_t *seg, uint32_t account_id) {
+    for (int k = 0; k < 3; k++) {
+        uint32_t bit = txn_segment_bloom_probe(account_id, k);
+        seg->bloom[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+}
+
+// 0 = the account has no row in the segment; 1 = it may have
+static inline int txn_segment_may_hold(const txn_segment_t *seg, uint32_t account_id) {
+    for (int k = 0; k < 3; k++) {
+        uint32_t bit = txn_segment_bloom_probe(account_id, k);
+        if (!(seg->bloom[bit / 8] & (1u << (bit % 8)))) return 0;
+    }
+    return 1;
+}
+
+// "YYYY-MM-DD" as the start of that UTC day (segments are cut on UTC days)
+static inline int txn_segment_parse_day(const char *s, time_t *out) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(s, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3) return 0;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    *out = timegm(&tm);
+    return *out != (time_t)-1;
+}
+
+/* --- TXN_ARCHIVE FORMAT (Cold tier for old segments) --- */
+// Archived rows are a prefix of transactions.db, packed into blocks of up to
+// TXN_ARCHIVE_BLOCK_ROWS rows. Each row is stored as varints relative to the row before
+// it (txn_id, accounts and time as deltas). txn_archive.idx maps each block to its bytes
+// in txn_archive.db, so a reader decompresses only the blocks it needs.
+#define TXN_ARCHIVE_BLOCK_ROWS 256
+typedef struct {
+    uint64_t first_row;         // transactions.db row of the block's first row
+    uint32_t rows;
+    uint32_t length;            // Compressed bytes
+    uint64_t offset;            // In txn_archive.db
+    uint64_t checksum;          // FNV-1a of the compressed bytes
+} txn_archive_block_t;
+typedef struct {
+    uint64_t txn_id;
+    uint32_t from_account;    
+    uint32_t to_account;      
+    double amount;
+    time_t timestamp;
+    char narration[128];
+} txn_legacy_rec_t;         // Pre-v1 row (160 bytes), read only by the converter/inspector
+
+/* --- BALANCES.CKPT FORMAT (Balance log mode checkpoint) --- */
+// Header, then 'count' money_t balances for account ids first_id, first_id + 1, ...
+// The file is replaced whole (write + fsync + rename), so it is never half written.
+#define BALANCE_CKPT_MAGIC 0x504B4342u  // "BCKP"
+#define BALANCE_CKPT_VERSION 1
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t log_rows;          // transactions.db rows already folded into the balances
+    uint32_t first_id;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t checksum;          // FNV-1a of the balance array
+} balance_ckpt_header_t;
+
+/* --- REDO.DB FORMAT (Multi-file operations) --- */
+// Append-only records. An entry carries the full change set of one operation: account
+// and loan after-images plus its transactions.db rows. A marker moves an earlier entry
+// on to APPLIED (images written), DONE (rows committed too) or CANCELLED. A CHECKPOINT
+// starts every emptied redo.db: the data files were synced first, and its seq is the
+// last one used, so entry numbers (and the records' redo stamps) keep increasing.
+#define REDO_MAGIC 0x4F444552u          // "REDO"
+typedef enum {
+    REDO_ENTRY = 1,
+    REDO_APPLIED,
+    REDO_DONE,
+    REDO_CANCELLED,         // Written but never made durable: the operation was refused
+    REDO_CHECKPOINT
+} redo_rec_kind_t;
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;              // redo_rec_kind_t
+    uint64_t seq;               // Entry number (markers: the entry they refer to)
+    uint64_t log_rows;          // Entry: transactions.db rows before it was committed
+    uint16_t accounts;          // Entry payload: accounts x account_rec_t,
+    uint16_t loans;             //   then loans x loan_rec_t,
+    uint16_t txns;              //   then txns x txn_rec_t
+    uint16_t reserved;
+    uint64_t checksum;          // FNV-1a of the header (this field zeroed) and payload
+} redo_rec_header_t;
 
 /* --- SERVER CONTEXT (Concurrency/Threading) --- */
 typedef struct {
@@ -135,5 +316,6 @@ void *client_thread_main(void *arg);
 ssize_t send_response(int fd, const response_t *resp);
 ssize_t recv_request(int fd, request_t *req);
 int ensure_db_dir_exists(void);
+int lock_db_dir(void);
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "utils.h"
+#include "db_index.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* --- RECORD TABLE ENGINE (Fixed-size records keyed by a numeric id) --- */
+// One engine drives users.db, loans.db and feedback.db: a primary index (key -> row),
+// in-place updates under record locks, appends under the table lock, and range scans.
+// Pooled tables serve reads and in-place updates from the server's buffer pool; appends
+// always go straight to the file. Cached tables also keep recently read records whole in
+// the record cache, refreshed by every in-place write.
+// Table-specific secondary indexes and queues hang off the hooks below, which run
+// under the table's index write lock whenever a row is indexed or rewritten.
+typedef struct {
+    void (*on_insert)(const void *rec, uint64_t row);                   // Row indexed (build, catch-up, append)
+    void (*on_update)(const void *old_rec, const void *new_rec);        // Row rewritten in place
+    void (*on_update_failed)(const void *old_rec, const void *new_rec); // Modifier ran but the write failed
+    uint64_t (*build_from)(void);   // First row the hooks need at build (dense tables only; NULL = 0)
+} table_hooks_t;
+
+typedef struct {
+    _Atomic uint64_t lookups;
+    _Atomic uint64_t lookup_misses;
+    _Atomic uint64_t reads;
+    _Atomic uint64_t updates;
+    _Atomic uint64_t appends;
+    _Atomic uint64_t rows_scanned;
+    _Atomic uint64_t versions_saved;    // Old row images kept for running snapshots
+    _Atomic uint64_t versions_lost;     // Images that could not be kept (snapshots read the current row)
+} table_stats_t;
+
+// Per-row write stamps live in lazily allocated chunks (rows past the last chunk are
+// read as current by snapshots)
+#define TABLE_VERSION_CHUNK_ROWS 4096
+#define TABLE_VERSION_CHUNKS 16384
+
+typedef struct {
+    uint64_t seq;           // Last commit the snapshot sees
+    uint64_t rows;          // Rows that existed when it began
+} table_snapshot_t;
+
+typedef struct {
+    db_table_id_t table;
+    size_t rec_size;
+    uint64_t (*key_of)(const void *rec);
+    int dense;              // key == row + 1 always: no primary index is kept
+    int pooled;             // Rows are read and rewritten through the buffer pool (when running)
+    int cached;             // Keyed reads go through the record cache (when running)
+    table_hooks_t hooks;
+
+    // Engine state
+    id_index_t primary;     // key -> row (keyed tables)
+    uint64_t covered;       // Rows already indexed
+    _Atomic int built;
+    pthread_rwlock_t index_lock;
+    table_stats_t stats;
+
+    // Snapshot state: a write stamp per row, and the images rewrites replaced
+    _Atomic uint64_t commit_seq;
+    _Atomic int snapshots;                  // Running snapshots
+    uint64_t *snapshot_seqs;                // Their seqs (versions_lock), to free images none of them sees
+    size_t snapshot_count, snapshot_cap;
+    int snapshots_untracked;                // Running snapshots whose seq could not be recorded
+    _Atomic(_Atomic uint64_t *) row_versions[TABLE_VERSION_CHUNKS];
+    pthread_mutex_t versions_lock;
+    id_index_t versions;                    // row + 1 -> newest saved image
+} record_table_t;
+
+#define TABLE_MAX_REC_SIZE 1024
+
+int table_build(record_table_t *t);                     // Idempotent; lookups build lazily too
+int table_catch_up(record_table_t *t);                  // Index rows appended by another process; 1 if any
+int table_has_unindexed(record_table_t *t);             // One fstat: 1 if the file holds rows not indexed yet
+int64_t table_find(record_table_t *t, uint64_t key);    // Row, or -1
+uint64_t table_row_count(record_table_t *t);
+
+int table_read(record_table_t *t, uint64_t key, void *out);
+int table_update(record_table_t *t, uint64_t key, int (*modifier)(void *rec, void *data), void *data);
+// table_update, then after() under the same record lock once the modifier succeeded;
+// written = 1 means the new row is in the file, not just in the buffer pool; the row
+// goes to the file first, so written = 0 leaves the old row everywhere (pool, cache, indexes)
+int table_update_then(record_table_t *t, uint64_t key, int (*modifier)(void *rec, void *data),
+                      void (*after)(const void *rec, int written, void *data), void *data);
+int table_write(record_table_t *t, const void *rec);     // Update in place, or append if the key is new
+// Append at EOF; assign_key (if given) sets the record's key from its row first
+int table_append(record_table_t *t, void *rec, void (*assign_key)(void *rec, uint64_t row));
+
+// Visit rows [from_row, EOF) in order until visit() returns 0 (table held shared).
+// Returns the number of rows visited, or -1 if the table cannot be read.
+int table_scan(record_table_t *t, uint64_t from_row, int (*visit)(const void *rec, uint64_t row, void *data), void *data);
+// Rewrite 'count' adjacent rows from 'first_row' with one pwrite (caller holds the table
+// exclusively and the index write lock). Not for cached tables: no record locks are taken,
+// so the record cache could not be kept in step.
+int table_put_rows(record_table_t *t, uint64_t first_row, const void *recs, size_t count);
+int table_get_row(record_table_t *t, uint64_t row, void *out);
+
+// Secondary indexes maintained by the hooks share the engine's index lock
+void table_index_lock(record_table_t *t, lock_mode_t mode);
+void table_index_unlock(record_table_t *t);
+
+/* --- SNAPSHOTS (Point-in-time reads that take no table or record locks) --- */
+// A snapshot sees every row as of the moment it began; writers carry on meanwhile and
+// keep the images they replace while a running snapshot began before them. If an image
+// cannot be kept, a snapshot reads that row's current image and versions_lost counts it.
+// Use the _locked form under
+// the index read lock to line a snapshot up with a secondary index lookup.
+table_snapshot_t table_snapshot_begin(record_table_t *t);
+table_snapshot_t table_snapshot_begin_locked(record_table_t *t);
+void table_snapshot_end(record_table_t *t, const table_snapshot_t *snap);
+// Visit rows as of the snapshot, in order, until visit() returns 0; -1 if unreadable
+int table_scan_snapshot(record_table_t *t, const table_snapshot_t *snap,
+                        int (*visit)(const void *rec, uint64_t row, void *data), void *data);
+// Visit the records of 'keys' as of the snapshot (keys that did not exist then are skipped)
+int table_visit_keys_snapshot(record_table_t *t, const table_snapshot_t *snap, const uint64_t *keys, size_t count,
+                              int (*visit)(const void *rec, void *data), void *data);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TXN_ARCHIVE_H
+#define TXN_ARCHIVE_H
+
+#include "server.h"
+#include <stdatomic.h>
+
+/* --- TRANSACTION ARCHIVE (Compressed cold tier of transactions.db) --- */
+// Sealed segments older than BANK_ARCHIVE_DAYS are recompressed into txn_archive.db by
+// the server's archiver (txn_log.c); their rows in transactions.db are then released
+// (hole-punched where the filesystem supports it) but keep their row numbers. Readers
+// go through txn_log.c, which sends archived rows here.
+//   BANK_ARCHIVE_DAYS  age of the newest row before a segment is archived (default 90)
+//   BANK_ARCHIVE_SEC   how often the archiver looks for such segments (default 3600)
+// This module only uses the two archive files, so the inspector can read archives too.
+#define ARCHIVE_DAYS_ENV "BANK_ARCHIVE_DAYS"
+#define ARCHIVE_SEC_ENV "BANK_ARCHIVE_SEC"
+#define ARCHIVE_DAYS_DEFAULT 90
+#define ARCHIVE_SEC_DEFAULT 3600
+#define TXN_ARCHIVE_CACHE_BLOCKS 8      // Decompressed blocks kept for nearby reads
+
+typedef struct {
+    _Atomic uint64_t rows;              // Rows archived so far
+    _Atomic uint64_t bytes;             // Their compressed size (txn_archive.db)
+    _Atomic uint64_t blocks_decoded;    // Blocks decompressed for readers
+    _Atomic uint64_t cache_hits;        // Reads served from an already decompressed block
+} txn_archive_stats_t;
+
+// Load the block index. Writable (the server's log start-up only) also drops a block left
+// half-written by a crash: the server's db/ lock means no other archiver can be appending.
+// Read-only opens (inspector) never create or truncate the files. 0 on success.
+int txn_archive_open(int writable);
+uint64_t txn_archive_rows(void);        // Rows [0, n) of transactions.db are archived
+// Copy up to 'max' archived rows from 'row' (fewer at a block boundary); 0 on error
+size_t txn_archive_read(uint64_t row, size_t max, txn_disk_rec_t *out);
+// Archive 'count' rows starting at txn_archive_rows(), synced before it returns 1
+int txn_archive_append(const txn_disk_rec_t *rows, size_t count);
+// Give the disk space of archived rows back (no-op where holes are not supported)
+void txn_archive_release_hot(int fd, off_t offset, off_t length);
+const txn_archive_stats_t *txn_archive_stats(void);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TXN_LOG_H
+#define TXN_LOG_H
+
+#include "server.h"
+#include <stdatomic.h>
+
+/* --- TRANSACTION LOG (Group commit for transactions.db) --- */
+// Durability policy, read once from the environment:
+//   BANK_TXN_FSYNC=txn    one write + fdatasync per transaction
+//   BANK_TXN_FSYNC=group  batch everything arriving within BANK_TXN_GROUP_US (default)
+//   BANK_TXN_FSYNC=none   batched writes left to the OS page cache
+#define TXN_FSYNC_ENV "BANK_TXN_FSYNC"
+#define TXN_GROUP_WINDOW_ENV "BANK_TXN_GROUP_US"
+#define TXN_GROUP_WINDOW_US_DEFAULT 1000
+#define TXN_LOG_BATCH_MAX 256
+
+typedef enum {
+    TXN_FSYNC_TXN = 0,
+    TXN_FSYNC_GROUP,
+    TXN_FSYNC_NONE
+} txn_fsync_policy_t;
+
+/* --- POSTING INDEX (txn_postings.db: entry N describes transactions.db row N) --- */
+typedef struct {
+    uint32_t account_id;    // Account whose history the row belongs to
+    uint32_t reserved;
+    int64_t prev;           // That account's previous row, -1 if none
+} txn_posting_t;
+
+int txn_log_convert_legacy(void);   // Rewrites a pre-v1 transactions.db; call before init_db_tables
+int init_txn_log(void);             // Indexes unposted rows, starts the writer thread
+int txn_log_append(txn_rec_t *tx);  // Assigns tx->txn_id; returns once the batch is committed
+int txn_log_append_all(txn_rec_t *txs, int count);  // Same, for rows that must commit in one write
+
+// Calls visit() on each of the account's rows, newest first, until it returns 0.
+// Returns the number of rows visited, or -1 if the log cannot be read.
+int txn_log_history(uint32_t account_id, int (*visit)(const txn_rec_t *tx, void *data), void *data);
+
+// Committed rows (-1 if the log cannot be read), and a replay of rows [from_row, end) in
+// order after syncing them; returns the rows replayed, or -1 (e.g. the log is shorter)
+int64_t txn_log_rows(void);
+int64_t txn_log_replay(uint64_t from_row, void (*visit)(const txn_rec_t *tx, void *data), void *data);
+
+/* --- RANGE SCAN (Skips transactions.db segments by their txn_segments.db footers) --- */
+typedef struct {
+    _Atomic uint64_t scans;
+    _Atomic uint64_t segments_read;     // Footer matched: rows read
+    _Atomic uint64_t segments_skipped;  // Footer ruled the segment out
+} txn_range_stats_t;
+
+// Calls visit() on the rows stamped within [from, to] that involve account_id (0 = any),
+// newest first, until it returns 0. Returns the rows visited, or -1 on a read error.
+int txn_log_range(uint32_t account_id, time_t from, time_t to,
+                  int (*visit)(const txn_rec_t *tx, void *data), void *data);
+const txn_range_stats_t *txn_log_range_stats(void);
+
+// Archiver thread (server only): moves old sealed segments into txn_archive.db (txn_archive.h)
+int txn_archiver_start(void);
+void txn_archiver_stop(void);
+
+#endif
@@ -8,15 +8,47 @@
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <stdatomic.h>
 #include "server.h"
+#include "lock_manager.h"
 
-/* --- FILE LOCKING (Concurrency: fcntl) --- */
-int lock_file(int fd);      // Full-file lock (search/append)
+/* --- FILE LOCKING (Concurrency: fcntl, across processes only) --- */
+int lock_file(int fd);          // Exclusive full-file lock (rewrite/append)
+int lock_file_shared(int fd);   // Shared full-file lock (read-only passes)
 int unlock_file(int fd);
 
+/* --- TABLE HANDLES (Shared per-process descriptors + in-process locks) --- */
+typedef enum {
+    DB_USERS = 0,
+    DB_ACCOUNTS,
+    DB_TRANSACTIONS,
+    DB_LOANS,
+    DB_FEEDBACK,
+    DB_TXN_POSTINGS,        // Guarded by the DB_TRANSACTIONS lock
+    DB_TXN_SEGMENTS,        // Guarded by the DB_TRANSACTIONS lock
+    DB_FEEDBACK_WATERMARK,  // Guarded by the DB_FEEDBACK lock
+    DB_REDO,                // Append-only; written by redo_log.c only
+    DB_TABLE_COUNT
+} db_table_id_t;
+_Static_assert(DB_TABLE_COUNT <= LOCK_MANAGER_TABLES, "every table needs a lock manager slot");
+
+int init_db_tables(void);
+int db_table_fd(db_table_id_t table);       // Shared descriptor: use pread/pwrite, never close
+int db_table_lock(db_table_id_t table, lock_mode_t mode);   // Exclusive also takes the fcntl file lock
+int db_table_unlock(db_table_id_t table, lock_mode_t mode);
+// The table's fcntl lock alone, shared between this process's threads (see utils.c)
+int db_file_lock(db_table_id_t table, lock_mode_t mode);
+int db_file_unlock(db_table_id_t table, lock_mode_t mode);
+
+/* --- STARTUP (Format migrations, in-memory indexes) --- */
+int migrate_db_files(void);
+int init_db_indexes(void);
+int init_account_map(void);
+
 /* --- USER PERSISTENCE --- */
 int write_user(user_rec_t *user);
 int read_user(int userId, user_rec_t *user);
+int for_each_user(int (*visit)(const user_rec_t *user, void *data), void *data);  // File order, until visit() returns 0
 int generate_new_userId();
 
 /* --- ATOMIC R-M-W HANDLER (RECORD-LEVEL LOCKING) --- */
@@ -26,25 +58,75 @@ int atomic_update_user(uint32_t userId, int (*modifier)(user_rec_t *user, void *
 int write_account(account_rec_t *acc);
 int read_account(int userId, account_rec_t *acc);
 int atomic_update_account(uint32_t userId, int (*modifier)(account_rec_t *acc, void *data), void *modifier_data);
+// atomic_update_account whose change only lands once 'tx' is committed to the log (-1: the
+// modifier agreed but the append failed, so the balance is unchanged)
+int atomic_update_account_logged(uint32_t userId, int (*modifier)(account_rec_t *acc, void *data), void *modifier_data,
+                                 txn_rec_t *tx);
+// Log rows committed together with a redo-logged update (the modifier may fill them in)
+typedef struct {
+    txn_rec_t *rows;
+    int count;
+} txn_rows_t;
+// Both records locked at once (fixed lock order); both written or neither, crash-safe via redo.db
+int atomic_update_account_pair(uint32_t firstId, uint32_t secondId,
+                               int (*modifier)(account_rec_t *first, account_rec_t *second, void *data), void *modifier_data,
+                               txn_rows_t *log);
+// One source against up to MAX_BATCH_TRANSFER_ITEMS others, all locked in one pass
+int atomic_update_account_batch(uint32_t srcId, const uint32_t *otherIds, int count,
+                                int (*modifier)(account_rec_t *src, account_rec_t **others, void *data), void *modifier_data,
+                                txn_rows_t *log);
+int for_each_account(int (*visit)(const account_rec_t *acc, void *data), void *data);  // Slot order
+int set_account_balance(uint32_t accountId, money_t balance);   // Startup balance recovery
+// Balance log mode (balance_log.c): balances are kept in memory; flush writes them to accounts.db
+int account_balances_to_memory(void);
+int account_balances_flush(void);
+int account_map_sync(void);     // msync accounts.db as it is (redo checkpoints)
 
 /* --- TRANSACTION PERSISTENCE --- */
 int append_transaction(txn_rec_t *tx);
+int append_transactions(txn_rec_t *txs, int count);   // Committed in one write, all or none
 
 /* --- LOAN PERSISTENCE --- */
 int read_loan(uint64_t loanId, loan_rec_t *loan);
 int write_loan(loan_rec_t *loan);
 int append_loan(loan_rec_t *loan); // Added for new loan applications
 int atomic_update_loan(uint64_t loanId, int (*modifier)(loan_rec_t *loan, void *data), void *modifier_data);
+// Loan and its applicant's account in one redo-logged change (acc is NULL if there is no account)
+int atomic_update_loan_account(uint64_t loanId, int (*modifier)(loan_rec_t *loan, account_rec_t *acc, void *data),
+                               void *modifier_data, txn_rows_t *log);
+
+typedef enum {
+    LOAN_BY_STATUS = 0,
+    LOAN_BY_ASSIGNEE,
+    LOAN_BY_APPLICANT
+} loan_index_field_t;
+
+// Indexed loan query: visits matching loans in id order; returns the count visited (-1 on error)
+int for_each_loan(loan_index_field_t field, uint64_t key, int (*visit)(const loan_rec_t *loan, void *data), void *data);
 
 /* --- FEEDBACK PERSISTENCE --- */
 int append_feedback(feedback_rec_t *fb);
 int write_feedback(feedback_rec_t *fb);
 int read_feedback(uint64_t fbId, feedback_rec_t *fb);
+int review_pending_feedback(void (*visit)(const feedback_rec_t *fb, void *data), void *data); // Marks them reviewed
+int for_each_feedback(int (*visit)(const feedback_rec_t *fb, void *data), void *data);
 
 /* --- SECURITY & AUTH --- */
 int login_user(const char *username, const char *password, int *userId, char *role, size_t role_sz, char *fname_out, size_t fname_sz);
 void generate_password_hash(const char *password, char *hash_output, size_t hash_size);
 int verify_password(const char *password, const char *hash);
-int check_uniqueness(const char* username, const char* email, const char* phone, uint32_t current_user_id, char* resp_msg, size_t resp_sz);
+// Logins probe a bloom filter over usernames first (rebuilt by init_db_indexes, fed by
+// every new users.db row): a name it rules out is rejected without the index or the file
+typedef struct {
+    _Atomic uint64_t lookups;
+    _Atomic uint64_t rejected;          // Unknown usernames turned away by the filter alone
+    _Atomic uint64_t false_positives;   // Unknown usernames the filter let through to the index
+} username_filter_stats_t;
+const username_filter_stats_t *username_filter_stats(void);
+double username_filter_expected_rate(void);     // False-positive rate implied by the fill
+// Unique-key owners: an existing user's id, or a new user's pending ticket (< -1, never reused)
+int64_t new_user_ticket(void);
+int check_uniqueness(const char* username, const char* email, const char* phone, int64_t owner, char* resp_msg, size_t resp_sz); // Reserves on success
+void release_user_keys(const char *username, const char *email, const char *phone, int64_t owner);
 
 #endif
\ No newline at end of file
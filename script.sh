@@ -1,16 +1,16 @@
 #!/bin/bash
 
 # Compile server.c and other modules
-gcc -o server src/server.c src/utils.c src/customer_module.c src/employee_module.c src/manager_module.c src/admin_module.c -Iinclude -pthread
+gcc -o server src/server.c src/utils.c src/db_index.c src/table.c src/buffer_pool.c src/record_cache.c src/balance_log.c src/redo_log.c src/lock_manager.c src/txn_log.c src/txn_archive.c src/customer_module.c src/employee_module.c src/manager_module.c src/admin_module.c -Iinclude -pthread
 
 # Compile client.c 
 gcc -o client src/client.c -Iinclude
 
 # Compile boostrap.c
-gcc -o bootstrap src/bootstrap.c src/admin_module.c src/utils.c src/employee_module.c src/customer_module.c -Iinclude
+gcc -o bootstrap src/bootstrap.c src/admin_module.c src/utils.c src/db_index.c src/table.c src/buffer_pool.c src/record_cache.c src/redo_log.c src/lock_manager.c src/txn_log.c src/txn_archive.c src/employee_module.c src/customer_module.c -Iinclude -pthread
 
 #Compile inspector.c
-gcc -o inspector src/db_inspector.c -Iinclude
+gcc -o inspector src/db_inspector.c src/txn_archive.c -Iinclude -pthread
 
 echo "######################################################"
 echo "  Banking-Management-System compiled successfully!!!   "
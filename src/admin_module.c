@@ -124,24 +124,9 @@ int change_user_role(uint32_t userId, const char *role_str, char *resp_msg, size
 // add_employee (Adds new staff user - Atomic creation)
 int add_employee(const char *first_name, const char *last_name, int age, const char *address, const char *role_str, const char *email, const char *phone, const char *username, const char *password, char *resp_msg, size_t resp_sz)
 {
-    if (!check_uniqueness(username, email, phone, 0, resp_msg, resp_sz)) {     
-        return 0;   
-    }
     user_rec_t user;
     memset(&user, 0, sizeof(user_rec_t));       
 
-    user.user_id = generate_new_userId();
-    user.age = age;
-    user.active = STATUS_ACTIVE;
-    user.created_at = time(NULL);
-
-    strncpy(user.first_name, first_name, sizeof(user.first_name) - 1);
-    strncpy(user.last_name, last_name, sizeof(user.last_name) - 1);
-    strncpy(user.address, address, sizeof(user.address) - 1);
-    strncpy(user.username, username, sizeof(user.username) - 1);
-    strncpy(user.email, email, sizeof(user.email) - 1);
-    strncpy(user.phone, phone, sizeof(user.phone) - 1);
-
     if (strcmp(role_str, "employee") == 0)
         user.role = ROLE_EMPLOYEE;
     else if (strcmp(role_str, "manager") == 0)
@@ -154,6 +139,24 @@ int add_employee(const char *first_name, const char *last_name, int age, const c
         return 0;
     }
 
+    // Reserves username/email/phone; released below if the write fails
+    int64_t ticket = new_user_ticket();
+    if (!check_uniqueness(username, email, phone, ticket, resp_msg, resp_sz)) {     
+        return 0;   
+    }
+
+    user.user_id = generate_new_userId();
+    user.age = age;
+    user.active = STATUS_ACTIVE;
+    user.created_at = time(NULL);
+
+    strncpy(user.first_name, first_name, sizeof(user.first_name) - 1);
+    strncpy(user.last_name, last_name, sizeof(user.last_name) - 1);
+    strncpy(user.address, address, sizeof(user.address) - 1);
+    strncpy(user.username, username, sizeof(user.username) - 1);
+    strncpy(user.email, email, sizeof(user.email) - 1);
+    strncpy(user.phone, phone, sizeof(user.phone) - 1);
+
     generate_password_hash(password, user.password_hash, sizeof(user.password_hash));
 
     if (write_user(&user))
@@ -162,60 +165,58 @@ int add_employee(const char *first_name, const char *last_name, int age, const c
         return 1;
     }
 
+    release_user_keys(username, email, phone, ticket);
     snprintf(resp_msg, resp_sz, "Employee Add Failed (Write Error)");
     return 0;
 }
 
-// list_all_users (Read-only list)
-int list_all_users(char *resp_msg, size_t resp_sz)
+/* --- Visitor for list_all_users (users.db in file order) --- */
+typedef struct {
+    char *resp_msg;
+    size_t resp_sz;
+    size_t current_len;
+    int found;
+} user_list_data;
+
+int user_list_visitor(const user_rec_t *user, void *data)
 {
-    int fd = open(USERS_DB_FILE, O_RDONLY);
-    if (fd < 0)
+    user_list_data *d = (user_list_data *)data;
+    char tmp[256];
+    if (user->role == ROLE_ADMIN)
+        return 1;
+
+    snprintf(tmp, sizeof(tmp), "%-4u | %-15s | %s\n",
+             user->user_id,
+             user->username,
+             get_role_str_for_list(user->role));
+
+    d->found = 1;
+    if (d->current_len + strlen(tmp) < d->resp_sz)
     {
-        snprintf(resp_msg, resp_sz, "Failed to open user database");
-        return 0;
+        strncat(d->resp_msg, tmp, d->resp_sz - d->current_len - 1);
+        d->current_len += strlen(tmp);
+        return 1;
     }
+    strncat(d->resp_msg, "... (list truncated) ...\n", d->resp_sz - d->current_len - 1);
+    return 0;
+}
 
-    lock_file(fd);
-
-    user_rec_t user;
-    char tmp[256];
+// list_all_users (Read-only list)
+int list_all_users(char *resp_msg, size_t resp_sz)
+{
     resp_msg[0] = '\0';
-    int found = 0;
-    size_t current_len = 0;
-
     snprintf(resp_msg, resp_sz, "--- User List ---\n");
     strncat(resp_msg, "ID   | Username        | Role\n", resp_sz - strlen(resp_msg) - 1);
     strncat(resp_msg, "---- | --------------- | --------\n", resp_sz - strlen(resp_msg) - 1);
-    current_len = strlen(resp_msg);
 
-    while (read(fd, &user, sizeof(user_rec_t)) == sizeof(user_rec_t))
+    user_list_data data = {resp_msg, resp_sz, strlen(resp_msg), 0};
+    if (for_each_user(user_list_visitor, &data) < 0)
     {
-        if (user.role != ROLE_ADMIN)
-        {
-            snprintf(tmp, sizeof(tmp), "%-4u | %-15s | %s\n",
-                     user.user_id,
-                     user.username,
-                     get_role_str_for_list(user.role));
-
-            if (current_len + strlen(tmp) < resp_sz)
-            {
-                strncat(resp_msg, tmp, resp_sz - current_len - 1);
-                current_len += strlen(tmp);
-            }
-            else
-            {
-                strncat(resp_msg, "... (list truncated) ...\n", resp_sz - current_len - 1);
-                break;
-            }
-            found = 1;
-        }
+        snprintf(resp_msg, resp_sz, "Failed to open user database");
+        return 0;
     }
 
-    unlock_file(fd);
-    close(fd);
-
-    if (!found)
+    if (!data.found)
     {
         snprintf(resp_msg, resp_sz, "No customers or employees found.");
     }
@@ -0,0 +1,234 @@
+#include "balance_log.h"
+#include "utils.h"
+#include "txn_log.h"
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * --- BALANCE LOG MODULE (Checkpoint + log replay) ---
+ * The checkpointer keeps its own copy of the balances, built only from balances.ckpt and
+ * the log rows after it, so a checkpoint always matches its log position exactly no
+ * matter what the client threads are doing. Live balances are seeded from the same copy
+ * at startup and then move with each operation; both agree once its row is committed.
+ */
+
+static int bl_enabled = 0;
+static balance_log_stats_t bl_stats;
+
+// Checkpointer state (startup, then the checkpointer thread only)
+static money_t *ckpt_balances = NULL;   // By account_id - USER_ID_BASE
+static size_t ckpt_count = 0;
+static uint64_t ckpt_rows = 0;          // Log rows folded into ckpt_balances
+
+static long bl_period_sec = CHECKPOINT_SEC_DEFAULT;
+static int bl_stop = 0;
+static pthread_mutex_t bl_stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bl_stop_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t bl_checkpointer;
+static int bl_checkpointer_running = 0;
+
+/* --- CHECKPOINT BALANCES --- */
+
+static money_t *ckpt_slot(uint32_t accountId) {
+    if (accountId < USER_ID_BASE) return NULL;
+    size_t idx = accountId - USER_ID_BASE;
+    if (idx >= ckpt_count) {
+        size_t count = ckpt_count ? ckpt_count * 2 : 1024;
+        while (count <= idx) count *= 2;
+        money_t *grown = realloc(ckpt_balances, count * sizeof(money_t));
+        if (grown == NULL) return NULL;
+        memset(grown + ckpt_count, 0, (count - ckpt_count) * sizeof(money_t));
+        ckpt_balances = grown;
+        ckpt_count = count;
+    }
+    return &ckpt_balances[idx];
+}
+
+// Debits come off the sender, credits (deposits, loans, transfers in) go to the receiver
+static void ckpt_apply(const txn_rec_t *tx, void *data) {
+    (void)data;
+    money_t *bal = NULL;
+    if (tx->type == TXN_WITHDRAW || tx->type == TXN_TRANSFER_OUT) {
+        if ((bal = ckpt_slot(tx->from_account)) != NULL) *bal -= tx->amount;
+    } else if (tx->type == TXN_DEPOSIT || tx->type == TXN_TRANSFER_IN || tx->type == TXN_LOAN_DEPOSIT) {
+        if ((bal = ckpt_slot(tx->to_account)) != NULL) *bal += tx->amount;
+    }
+}
+
+static int ckpt_seed_visitor(const account_rec_t *acc, void *data) {
+    (void)data;
+    money_t *bal = ckpt_slot(acc->account_id);
+    if (bal) *bal = acc->balance;
+    return bal != NULL;
+}
+
+static uint64_t ckpt_checksum(const money_t *balances, size_t count) {
+    return fnv1a_update(FNV1A_INIT, balances, count * sizeof(money_t));
+}
+
+/* --- BALANCES.CKPT I/O --- */
+
+// 1 if a checkpoint was loaded, 0 if there is none, -1 if it is unreadable
+static int ckpt_load(void) {
+    int fd = open(BALANCE_CKPT_FILE, O_RDONLY);
+    if (fd < 0) return 0;
+    balance_ckpt_header_t hdr;
+    int rc = -1;
+    if (pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) && hdr.magic == BALANCE_CKPT_MAGIC &&
+        hdr.version == BALANCE_CKPT_VERSION && hdr.first_id == USER_ID_BASE) {
+        money_t *balances = malloc((hdr.count ? hdr.count : 1) * sizeof(money_t));
+        ssize_t want = (ssize_t)(hdr.count * sizeof(money_t));
+        if (balances && pread(fd, balances, want, sizeof(hdr)) == want &&
+            ckpt_checksum(balances, hdr.count) == hdr.checksum) {
+            free(ckpt_balances);
+            ckpt_balances = balances;
+            ckpt_count = hdr.count;
+            ckpt_rows = hdr.log_rows;
+            rc = 1;
+        } else {
+            free(balances);
+        }
+    }
+    close(fd);
+    return rc;
+}
+
+// Replace balances.ckpt: write a temporary file, sync it, rename it over the old one
+static int ckpt_write(void) {
+    const char *tmp_path = BALANCE_CKPT_FILE ".tmp";
+    balance_ckpt_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = BALANCE_CKPT_MAGIC;
+    hdr.version = BALANCE_CKPT_VERSION;
+    hdr.log_rows = ckpt_rows;
+    hdr.first_id = USER_ID_BASE;
+    hdr.count = ckpt_count;
+    hdr.checksum = ckpt_checksum(ckpt_balances, ckpt_count);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return 0;
+    ssize_t want = (ssize_t)(ckpt_count * sizeof(money_t));
+    int ok = pwrite(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) &&
+             (want == 0 || pwrite(fd, ckpt_balances, want, sizeof(hdr)) == want) &&
+             fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp_path, BALANCE_CKPT_FILE) != 0) {
+        unlink(tmp_path);
+        return 0;
+    }
+    atomic_fetch_add(&bl_stats.checkpoints, 1);
+    atomic_store(&bl_stats.log_rows, ckpt_rows);
+    return 1;
+}
+
+// Fold the log rows committed since the last checkpoint in; -1 if the log cannot be read
+static int64_t ckpt_catch_up(void) {
+    int64_t replayed = txn_log_replay(ckpt_rows, ckpt_apply, NULL);
+    if (replayed > 0) {
+        ckpt_rows += replayed;
+        atomic_fetch_add(&bl_stats.rows_replayed, replayed);
+    }
+    return replayed;
+}
+
+// Push the checkpoint balances into the live accounts
+static void ckpt_restore(void) {
+    for (size_t i = 0; i < ckpt_count; i++) {
+        set_account_balance((uint32_t)(USER_ID_BASE + i), ckpt_balances[i]);
+    }
+}
+
+/* --- CHECKPOINTER THREAD --- */
+
+static void *bl_checkpointer_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&bl_stop_lock);
+    while (!bl_stop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += bl_period_sec;
+        pthread_cond_timedwait(&bl_stop_cond, &bl_stop_lock, &wake);
+        if (bl_stop) break;
+        pthread_mutex_unlock(&bl_stop_lock);
+        if (ckpt_catch_up() > 0 && !ckpt_write()) perror("balance checkpoint");
+        pthread_mutex_lock(&bl_stop_lock);
+    }
+    pthread_mutex_unlock(&bl_stop_lock);
+    return NULL;
+}
+
+/* --- LIFECYCLE --- */
+
+int balance_log_init(void) {
+    const char *mode = getenv(BALANCE_MODE_ENV);
+    int log_mode = (mode != NULL && strcmp(mode, "log") == 0);
+    if (mode != NULL && !log_mode && strcmp(mode, "inplace") != 0) {
+        fprintf(stderr, "Unknown %s '%s', using inplace\n", BALANCE_MODE_ENV, mode);
+    }
+    const char *period = getenv(CHECKPOINT_SEC_ENV);
+    if (period != NULL && atol(period) > 0) bl_period_sec = atol(period);
+
+    int loaded = ckpt_load();
+    if (loaded < 0) {
+        fprintf(stderr, "%s is damaged; refusing to guess balances\n", BALANCE_CKPT_FILE);
+        return -1;
+    }
+    if (!loaded && !log_mode) return 0;     // Balances live in accounts.db as always
+
+    if (loaded) {
+        // Balances as of the checkpoint plus everything logged after it
+        if (ckpt_catch_up() < 0) {
+            fprintf(stderr, "%s is behind %s; cannot replay balances\n", TRANSACTIONS_DB_FILE, BALANCE_CKPT_FILE);
+            return -1;
+        }
+    } else {
+        // First log mode start: accounts.db is current up to the log's end
+        int64_t rows = txn_log_rows();
+        if (rows < 0 || for_each_account(ckpt_seed_visitor, NULL) < 0) return -1;
+        ckpt_rows = (uint64_t)rows;
+    }
+
+    if (!log_mode) {
+        // Left over from a log mode run: put the balances back into accounts.db
+        ckpt_restore();
+        if (!account_balances_flush()) return -1;
+        unlink(BALANCE_CKPT_FILE);
+        printf("Recovered balances into %s (%llu log rows replayed)\n", ACCOUNTS_DB_FILE,
+               (unsigned long long)bl_stats.rows_replayed);
+        return 0;
+    }
+
+    if (!account_balances_to_memory()) return -1;
+    ckpt_restore();
+    if (!ckpt_write()) {
+        perror("balance checkpoint");
+        return -1;
+    }
+    bl_enabled = 1;
+    if (pthread_create(&bl_checkpointer, NULL, bl_checkpointer_main, NULL) != 0) {
+        perror("balance checkpointer");
+        return -1;
+    }
+    bl_checkpointer_running = 1;
+    return 0;
+}
+
+void balance_log_shutdown(void) {
+    if (!bl_enabled) return;
+    pthread_mutex_lock(&bl_stop_lock);
+    bl_stop = 1;
+    pthread_cond_signal(&bl_stop_cond);
+    pthread_mutex_unlock(&bl_stop_lock);
+    if (bl_checkpointer_running) pthread_join(bl_checkpointer, NULL);
+    bl_checkpointer_running = 0;
+    if (ckpt_catch_up() > 0 && !ckpt_write()) perror("balance checkpoint");
+    if (!account_balances_flush()) perror("flush balances");
+}
+
+int balance_log_enabled(void) {
+    return bl_enabled;
+}
+
+const balance_log_stats_t *balance_log_stats(void) {
+    return &bl_stats;
+}
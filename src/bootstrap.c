@@ -4,6 +4,7 @@
 #include "admin_module.h" 
 #include "employee_module.h" 
 #include "server.h"       
+#include "utils.h"
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>     
@@ -18,6 +19,9 @@ int main() {
     } else {
         printf("db directory ensured.\n");
     }
+    if (migrate_db_files() != 0) {     // Existing data must be in the current format before adding to it
+        return 1;
+    }
     
     char resp_msg[MAX_MSG_LEN];   // Response message buffer (describing what happened (success/failure, reason, etc.))
     int success_count = 0;      // Count of successfully created users
@@ -0,0 +1,323 @@
+#include "buffer_pool.h"
+#include "db_index.h"
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * --- BUFFER POOL MODULE (Clock eviction, pin counts, background write-back) ---
+ * Frames are split across BP_PARTITIONS partitions by page; each partition has its own
+ * lock, resident map and clock hand. A frame is pinned while a caller copies rows in or
+ * out under the frame's latch, so the clock only ever evicts unpinned frames. A page is
+ * filled lazily up to the rows actually asked for: rows appended later (by this server
+ * or by bootstrap) are read in on first use, and a half-written append is never cached.
+ *
+ * Lock order: partition lock, then frame latch.
+ */
+
+typedef struct {
+    // Set under both the partition lock and the latch
+    uint64_t tag;           // 0 = free
+    db_table_id_t table;
+    uint64_t page_no;
+    size_t rec_size;
+    uint32_t rows;          // Rows per page
+    // Partition lock (pins may drop without it)
+    _Atomic int pins;
+    int ref;                // Clock reference bit
+    // Frame latch
+    pthread_mutex_t latch;
+    uint32_t valid;         // Rows [0, valid) hold file data
+    _Atomic int dirty;
+    char *data;
+} bp_frame_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    bp_frame_t *frames;
+    size_t count;
+    size_t hand;
+    id_index_t resident;    // tag -> frame slot of every cached page
+} bp_partition_t;
+
+static bp_partition_t bp_parts[BP_PARTITIONS];
+static char *bp_memory = NULL;
+static _Atomic int bp_ready = 0;
+static _Atomic int bp_closed = 0;     // Set by shutdown: writes that still land in a page write it back themselves
+static bp_stats_t bp_stats;
+
+static long bp_flush_ms = BUFFER_POOL_FLUSH_MS_DEFAULT;
+static int bp_stop = 0;
+static pthread_mutex_t bp_stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bp_stop_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t bp_flusher;
+static int bp_flusher_running = 0;
+
+#define bp_count(field, n) atomic_fetch_add_explicit(&bp_stats.field, (n), memory_order_relaxed)
+
+static uint64_t bp_tag(db_table_id_t table, uint64_t page_no) {
+    return ((uint64_t)(table + 1) << 48) | page_no;
+}
+
+static bp_partition_t *bp_partition_of(uint64_t tag) {
+    return &bp_parts[((tag * 0x9E3779B97F4A7C15ull) >> 32) % BP_PARTITIONS];
+}
+
+static off_t bp_row_offset(size_t rec_size, uint64_t row) {
+    return (off_t)(row * rec_size);
+}
+
+/* --- PAGE I/O (caller holds the frame latch) --- */
+
+// Read rows [valid, upto) of the page from the file
+static void bp_fill(bp_frame_t *f, uint32_t upto) {
+    if (upto > f->rows) upto = f->rows;
+    if (f->valid >= upto) return;
+    int fd = db_table_fd(f->table);
+    uint64_t first = f->page_no * f->rows + f->valid;
+    ssize_t got = pread(fd, f->data + f->valid * f->rec_size, (upto - f->valid) * f->rec_size,
+                        bp_row_offset(f->rec_size, first));
+    if (got > 0) f->valid += (uint32_t)(got / f->rec_size);
+}
+
+static int bp_write_back(bp_frame_t *f) {
+    if (!atomic_load(&f->dirty)) return 1;
+    int fd = db_table_fd(f->table);
+    ssize_t len = (ssize_t)(f->valid * f->rec_size);
+    if (pwrite(fd, f->data, len, bp_row_offset(f->rec_size, f->page_no * f->rows)) != len) return 0;
+    atomic_store(&f->dirty, 0);
+    bp_count(writebacks, 1);
+    return 1;
+}
+
+/* --- FRAME LOOKUP + CLOCK EVICTION --- */
+
+// Pin the frame caching 'tag', loading it on a miss. Returns NULL with the partition
+// lock still held when every frame is pinned (or could not be written back), so the
+// caller can go to the file without racing a concurrent load of the same page.
+static bp_frame_t *bp_pin(bp_partition_t *p, uint64_t tag, db_table_id_t table, size_t rec_size,
+                          uint64_t page_no, uint32_t upto) {
+    pthread_mutex_lock(&p->lock);
+    int64_t slot = id_index_get(&p->resident, tag);
+    if (slot >= 0) {
+        bp_frame_t *f = &p->frames[slot];
+        atomic_fetch_add(&f->pins, 1);
+        f->ref = 1;
+        pthread_mutex_unlock(&p->lock);
+        bp_count(hits, 1);
+        return f;
+    }
+    bp_count(misses, 1);
+
+    // Two sweeps: the first may only clear reference bits
+    for (size_t step = 0; step < 2 * p->count; step++) {
+        size_t idx = p->hand;
+        bp_frame_t *f = &p->frames[idx];
+        p->hand = (p->hand + 1) % p->count;
+        if (atomic_load(&f->pins) > 0) continue;
+        if (f->ref) { f->ref = 0; continue; }
+
+        pthread_mutex_lock(&f->latch);
+        if (f->tag != 0) {
+            if (!bp_write_back(f)) { pthread_mutex_unlock(&f->latch); continue; }
+            id_index_del(&p->resident, f->tag);
+            f->tag = 0;
+            bp_count(evictions, 1);
+        }
+        if (!id_index_put(&p->resident, tag, (int64_t)idx)) {
+            pthread_mutex_unlock(&f->latch);
+            break;
+        }
+        f->tag = tag;
+        f->table = table;
+        f->page_no = page_no;
+        f->rec_size = rec_size;
+        f->rows = BP_PAGE_SIZE / rec_size;
+        f->valid = 0;
+        bp_fill(f, upto);
+        f->ref = 1;
+        atomic_store(&f->pins, 1);
+        pthread_mutex_unlock(&f->latch);
+        pthread_mutex_unlock(&p->lock);
+        return f;
+    }
+    bp_count(bypasses, 1);
+    return NULL;
+}
+
+static void bp_unpin(bp_frame_t *f) {
+    atomic_fetch_sub(&f->pins, 1);
+}
+
+/* --- ROW ACCESS --- */
+
+int bp_read_rows(db_table_id_t table, size_t rec_size, uint64_t row, size_t max, void *out) {
+    uint32_t per_page = BP_PAGE_SIZE / rec_size;
+    uint64_t page_no = row / per_page;
+    uint32_t slot = row % per_page;
+    if (max > per_page - slot) max = per_page - slot;
+    uint64_t tag = bp_tag(table, page_no);
+    bp_partition_t *p = bp_partition_of(tag);
+
+    bp_frame_t *f = bp_pin(p, tag, table, rec_size, page_no, slot + max);
+    if (f == NULL) {
+        ssize_t got = pread(db_table_fd(table), out, max * rec_size, bp_row_offset(rec_size, row));
+        pthread_mutex_unlock(&p->lock);
+        return got > 0 ? (int)(got / rec_size) : 0;
+    }
+    pthread_mutex_lock(&f->latch);
+    bp_fill(f, slot + max);     // Rows appended since the page was loaded
+    size_t n = (slot < f->valid) ? f->valid - slot : 0;
+    if (n > max) n = max;
+    memcpy(out, f->data + slot * rec_size, n * rec_size);
+    pthread_mutex_unlock(&f->latch);
+    bp_unpin(f);
+    return (int)n;
+}
+
+// through = 1 writes the row to the file under the page latch first (so the flusher
+// cannot put an older copy of the page over it) and only then into the page
+static int bp_store_row(db_table_id_t table, size_t rec_size, uint64_t row, const void *rec, int through) {
+    uint32_t per_page = BP_PAGE_SIZE / rec_size;
+    uint64_t page_no = row / per_page;
+    uint32_t slot = row % per_page;
+    uint64_t tag = bp_tag(table, page_no);
+    bp_partition_t *p = bp_partition_of(tag);
+
+    bp_frame_t *f = bp_pin(p, tag, table, rec_size, page_no, slot + 1);
+    if (f == NULL) {
+        int ok = (pwrite(db_table_fd(table), rec, rec_size, bp_row_offset(rec_size, row)) == (ssize_t)rec_size);
+        pthread_mutex_unlock(&p->lock);
+        return ok;
+    }
+    pthread_mutex_lock(&f->latch);
+    bp_fill(f, slot + 1);
+    int ok = (slot < f->valid);     // Only existing rows are rewritten here; appends go to the file
+    if (ok && through)
+        ok = (pwrite(db_table_fd(table), rec, rec_size, bp_row_offset(rec_size, row)) == (ssize_t)rec_size);
+    if (ok) {
+        memcpy(f->data + slot * rec_size, rec, rec_size);
+        if (!through) atomic_store(&f->dirty, 1);
+        // A writer that picked the pool before shutdown may get here after the final
+        // flush passed this frame: nothing else would write the page back then
+        if (!through && atomic_load(&bp_closed)) ok = bp_write_back(f);
+    }
+    pthread_mutex_unlock(&f->latch);
+    bp_unpin(f);
+    return ok;
+}
+
+int bp_write_row(db_table_id_t table, size_t rec_size, uint64_t row, const void *rec) {
+    return bp_store_row(table, rec_size, row, rec, 0);
+}
+
+int bp_write_row_through(db_table_id_t table, size_t rec_size, uint64_t row, const void *rec) {
+    return bp_store_row(table, rec_size, row, rec, 1);
+}
+
+/* --- WRITE-BACK (flusher thread, shutdown) --- */
+
+// Write back every dirty page; 0 if any write failed
+static int bp_flush(void) {
+    int ok = 1;
+    for (int i = 0; i < BP_PARTITIONS; i++) {
+        bp_partition_t *p = &bp_parts[i];
+        for (size_t j = 0; j < p->count; j++) {
+            bp_frame_t *f = &p->frames[j];
+            pthread_mutex_lock(&p->lock);
+            if (f->tag == 0 || !atomic_load(&f->dirty)) {
+                pthread_mutex_unlock(&p->lock);
+                continue;
+            }
+            atomic_fetch_add(&f->pins, 1);
+            pthread_mutex_unlock(&p->lock);
+
+            pthread_mutex_lock(&f->latch);
+            if (!bp_write_back(f)) ok = 0;
+            pthread_mutex_unlock(&f->latch);
+            bp_unpin(f);
+        }
+    }
+    return ok;
+}
+
+static void *bp_flusher_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&bp_stop_lock);
+    while (!bp_stop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += bp_flush_ms / 1000;
+        wake.tv_nsec += (bp_flush_ms % 1000) * 1000000L;
+        if (wake.tv_nsec >= 1000000000L) { wake.tv_sec++; wake.tv_nsec -= 1000000000L; }
+        pthread_cond_timedwait(&bp_stop_cond, &bp_stop_lock, &wake);
+        if (bp_stop) break;
+        pthread_mutex_unlock(&bp_stop_lock);
+        if (!bp_flush()) perror("buffer pool write-back");
+        pthread_mutex_lock(&bp_stop_lock);
+    }
+    pthread_mutex_unlock(&bp_stop_lock);
+    return NULL;
+}
+
+/* --- LIFECYCLE --- */
+
+int buffer_pool_init(void) {
+    if (bp_ready) return 0;
+    long kb = BUFFER_POOL_KB_DEFAULT;
+    const char *env = getenv(BUFFER_POOL_ENV);
+    if (env != NULL && *env != '\0') kb = atol(env);
+    if (kb <= 0) return 0;      // Pool disabled: tables use the files directly
+    env = getenv(BUFFER_POOL_FLUSH_ENV);
+    if (env != NULL && atol(env) > 0) bp_flush_ms = atol(env);
+
+    size_t per_part = (size_t)kb * 1024 / BP_PAGE_SIZE / BP_PARTITIONS;
+    if (per_part == 0) per_part = 1;
+    bp_memory = calloc(per_part * BP_PARTITIONS, BP_PAGE_SIZE);
+    if (bp_memory == NULL) return -1;
+
+    char *page = bp_memory;
+    for (int i = 0; i < BP_PARTITIONS; i++) {
+        bp_partition_t *p = &bp_parts[i];
+        pthread_mutex_init(&p->lock, NULL);
+        p->frames = calloc(per_part, sizeof(bp_frame_t));
+        if (p->frames == NULL || !id_index_init(&p->resident, per_part * 2)) return -1;
+        p->count = per_part;
+        for (size_t j = 0; j < per_part; j++, page += BP_PAGE_SIZE) {
+            pthread_mutex_init(&p->frames[j].latch, NULL);
+            p->frames[j].data = page;
+        }
+    }
+    bp_ready = 1;
+
+    if (pthread_create(&bp_flusher, NULL, bp_flusher_main, NULL) == 0) {
+        bp_flusher_running = 1;
+    } else {
+        perror("buffer pool flusher");
+        bp_ready = 0;       // Never leave dirty pages without a writer
+        return -1;
+    }
+    return 0;
+}
+
+void buffer_pool_shutdown(void) {
+    if (!bp_ready) return;
+    pthread_mutex_lock(&bp_stop_lock);
+    bp_stop = 1;
+    pthread_cond_signal(&bp_stop_cond);
+    pthread_mutex_unlock(&bp_stop_lock);
+    if (bp_flusher_running) pthread_join(bp_flusher, NULL);
+    bp_flusher_running = 0;
+    // Client threads are not joined: later accesses go to the files, and a write already
+    // inside the pool writes its page back (bp_closed) if the flush below missed it
+    atomic_store(&bp_ready, 0);
+    atomic_store(&bp_closed, 1);
+    if (!bp_flush()) perror("buffer pool write-back");
+}
+
+int buffer_pool_enabled(void) {
+    return bp_ready;
+}
+
+const bp_stats_t *buffer_pool_stats(void) {
+    return &bp_stats;
+}
@@ -165,11 +165,27 @@ bool validate_credential(const char* input, char* error_msg, size_t err_sz) {
 }
 
 /*
- * read_valid_double
- * Helper to read a valid, positive monetary amount.
+ * validate_date_range
+ * Validator: Empty (no range), or two days as "YYYY-MM-DD YYYY-MM-DD".
+ */
+bool validate_date_range(const char* input, char* error_msg, size_t err_sz) {
+    int y1, m1, d1, y2, m2, d2;
+    char extra;
+    if (input[0] == '\0') return true;
+    if (sscanf(input, "%d-%d-%d %d-%d-%d %c", &y1, &m1, &d1, &y2, &m2, &d2, &extra) != 6 ||
+        m1 < 1 || m1 > 12 || d1 < 1 || d1 > 31 || m2 < 1 || m2 > 12 || d2 < 1 || d2 > 31) {
+        snprintf(error_msg, err_sz, "Enter two days as YYYY-MM-DD YYYY-MM-DD, or leave it blank");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * read_valid_amount
+ * Helper to read a valid, positive monetary amount (at most two decimals).
  * Loops until input is valid.
  */
-double read_valid_double(const char* prompt) {
+money_t read_valid_amount(const char* prompt) {
     char buffer[128];
     char error_msg[128];
     while (true) {
@@ -182,11 +198,9 @@ double read_valid_double(const char* prompt) {
             continue;
         }
 
-        char* endptr;
-        double value = strtod(buffer, &endptr);
-
-        if (endptr == buffer || *endptr != '\0') {
-            printf("Error: Invalid number. Please enter digits only (e.g., 100.50).\n");
+        money_t value;
+        if (!money_parse(buffer, &value)) {
+            printf("Error: Invalid amount. Please enter digits with at most two decimals (e.g., 100.50).\n");
         } else if (value <= 0) {
             printf("Error: Amount must be positive. Please try again.\n");
         } else {
@@ -233,22 +247,24 @@ void customer_menu(int userId, int sockfd, const char* userName) {
                 break;
             case 2:
                 {
-                    double amount = read_valid_double("Enter deposit amount");
+                    money_t amount = read_valid_amount("Enter deposit amount");
                     strcpy(req.op, "DEPOSIT");
-                    snprintf(req.payload, sizeof(req.payload), "%u %lf", userId, amount);
+                    char amt[MONEY_STR_LEN];
+                    snprintf(req.payload, sizeof(req.payload), "%u %s", userId, money_format(amount, amt, sizeof(amt)));
                 }
                 break;
             case 3:
                 {
-                    double amount = read_valid_double("Enter withdrawal amount");
+                    money_t amount = read_valid_amount("Enter withdrawal amount");
                     strcpy(req.op, "WITHDRAW");
-                    snprintf(req.payload, sizeof(req.payload), "%u %lf", userId, amount);
+                    char amt[MONEY_STR_LEN];
+                    snprintf(req.payload, sizeof(req.payload), "%u %s", userId, money_format(amount, amt, sizeof(amt)));
                 }
                 break;
             case 4:
                 {
                     int toId;
-                    double amount;
+                    money_t amount;
                     char acct_str[32];
                     printf("Enter recipient Account No (e.g., AC1005): ");
                     read_validated_string("", acct_str, sizeof(acct_str), validate_not_empty);
@@ -257,16 +273,18 @@ void customer_menu(int userId, int sockfd, const char* userName) {
                     } else {
                         toId = atoi(acct_str);
                     }
-                    amount = read_valid_double("Enter amount");
+                    amount = read_valid_amount("Enter amount");
                     strcpy(req.op, "TRANSFER");
-                    snprintf(req.payload, sizeof(req.payload), "%u %u %lf", userId, toId, amount);
+                    char amt[MONEY_STR_LEN];
+                    snprintf(req.payload, sizeof(req.payload), "%u %u %s", userId, toId, money_format(amount, amt, sizeof(amt)));
                 }
                 break;
             case 5:
                 {
-                    double loanAmount = read_valid_double("Enter loan amount");
+                    money_t loanAmount = read_valid_amount("Enter loan amount");
                     strcpy(req.op, "APPLY_LOAN");
-                    snprintf(req.payload, sizeof(req.payload), "%u %lf", userId, loanAmount);
+                    char amt[MONEY_STR_LEN];
+                    snprintf(req.payload, sizeof(req.payload), "%u %s", userId, money_format(loanAmount, amt, sizeof(amt)));
                 }
                 break;
             case 6:
@@ -426,8 +444,10 @@ void employee_menu(int userId, int sockfd, const char* userName) {
                     } else {
                         custId = atoi(acct_str);
                     }
+                    char range[64];
+                    read_validated_string("Enter date range FROM TO (YYYY-MM-DD YYYY-MM-DD, UTC; blank for all)", range, sizeof(range), validate_date_range);
                     strcpy(req.op, "VIEW_CUST_TRANSACTIONS");
-                    snprintf(req.payload, sizeof(req.payload), "%u", custId);
+                    snprintf(req.payload, sizeof(req.payload), "%u %s", custId, range);
                 }
                 break;
             case 7:
@@ -1,5 +1,6 @@
 #include "customer_module.h"
 #include "utils.h"
+#include "txn_log.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -7,13 +8,14 @@
 
 /* --- CUSTOMER MODULE LOGIC (Financial Transactions) --- */
 typedef struct {
-    double amount;
+    money_t amount;
 } txn_data_t;
 
 // Modifier for DEPOSIT (Executed under Record-Level Lock)
 int deposit_modifier(account_rec_t *acc, void *data) {
     txn_data_t *txn = (txn_data_t*)data;
     if (acc->active == STATUS_INACTIVE) return 0; 
+    if (acc->balance > MONEY_MAX - txn->amount) return 0;  // Would overflow
     acc->balance += txn->amount;
     return 1; 
 }
@@ -83,24 +85,30 @@ int view_balance(uint32_t user_id, char *resp_msg, size_t resp_sz) {
         snprintf(resp_msg, resp_sz, "Account not found");
         return 0;
     }
-    snprintf(resp_msg, resp_sz, "Balance: %.2lf (Status: %s)", acc.balance, acc.active == STATUS_ACTIVE ? "Active" : "Inactive");
+    char bal[MONEY_STR_LEN];
+    snprintf(resp_msg, resp_sz, "Balance: %s (Status: %s)", money_format(acc.balance, bal, sizeof(bal)), acc.active == STATUS_ACTIVE ? "Active" : "Inactive");
     return 1;
 }
 
 // deposit_money (Atomic Transaction: Lock + Modify + Atomic Log)
-int deposit_money(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz) {
+int deposit_money(uint32_t user_id, money_t amount, char *resp_msg, size_t resp_sz) {
     if (amount <= 0) {
         snprintf(resp_msg, resp_sz, "Deposit amount must be positive.");
         return 0;
     }
     
     txn_data_t data = {amount};
-    if (atomic_update_account(user_id, deposit_modifier, &data)) {
-        txn_rec_t tx = {0, 0, user_id, amount, time(NULL), "deposit"};
-        append_transaction(&tx);
-        snprintf(resp_msg, resp_sz, "Deposit Successful: %.2lf", amount);
+    txn_rec_t tx = {0, 0, user_id, amount, time(NULL), TXN_DEPOSIT};
+    int result = atomic_update_account_logged(user_id, deposit_modifier, &data, &tx);
+    if (result == 1) {
+        char amt[MONEY_STR_LEN];
+        snprintf(resp_msg, resp_sz, "Deposit Successful: %s", money_format(amount, amt, sizeof(amt)));
         return 1;
     }
+    if (result < 0) {
+        snprintf(resp_msg, resp_sz, "Deposit Failed: Could not record the transaction");
+        return 0;
+    }
     account_rec_t acc;
     if (read_account(user_id, &acc) && acc.active == STATUS_INACTIVE) {
         snprintf(resp_msg, resp_sz, "Deposit Failed: Account is inactive");
@@ -111,29 +119,66 @@ int deposit_money(uint32_t user_id, double amount, char *resp_msg, size_t resp_s
 }
 
 // withdraw_money (Atomic Transaction: Lock + Modify + Atomic Log)
-int withdraw_money(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz) {
+int withdraw_money(uint32_t user_id, money_t amount, char *resp_msg, size_t resp_sz) {
      if (amount <= 0) {
         snprintf(resp_msg, resp_sz, "Withdrawal amount must be positive.");
         return 0;
     }
 
     txn_data_t data = {amount};
-    if (atomic_update_account(user_id, withdraw_modifier, &data)) {
-        txn_rec_t tx = {0, user_id, 0, amount, time(NULL), "withdraw"};
-        append_transaction(&tx);
-        snprintf(resp_msg, resp_sz, "Withdrawal Successful: %.2lf", amount);
+    txn_rec_t tx = {0, user_id, 0, amount, time(NULL), TXN_WITHDRAW};
+    int result = atomic_update_account_logged(user_id, withdraw_modifier, &data, &tx);
+    if (result == 1) {
+        char amt[MONEY_STR_LEN];
+        snprintf(resp_msg, resp_sz, "Withdrawal Successful: %s", money_format(amount, amt, sizeof(amt)));
         return 1;
     }
+    if (result < 0) {
+        snprintf(resp_msg, resp_sz, "Withdrawal Failed: Could not record the transaction");
+        return 0;
+    }
     account_rec_t acc;
+    char bal[MONEY_STR_LEN];
     if (!read_account(user_id, &acc)) snprintf(resp_msg, resp_sz, "Withdrawal Failed: Account not found");
     else if (acc.active == STATUS_INACTIVE) snprintf(resp_msg, resp_sz, "Withdrawal Failed: Account is inactive");
-    else if (acc.balance < amount) snprintf(resp_msg, resp_sz, "Withdrawal Failed: Insufficient Balance (Current: %.2lf)", acc.balance);
+    else if (acc.balance < amount) snprintf(resp_msg, resp_sz, "Withdrawal Failed: Insufficient Balance (Current: %s)", money_format(acc.balance, bal, sizeof(bal)));
     else snprintf(resp_msg, resp_sz, "Withdrawal Failed: Unexpected error");
     return 0;
 }
 
-// transfer_funds (CRITICAL: Multi-step ACID Operation with Rollback)
-int transfer_funds(uint32_t from_id, uint32_t to_id, double amount, char *resp_msg, size_t resp_sz) {
+/* --- Modifier for transfer_funds (both accounts locked together) --- */
+typedef struct {
+    money_t amount;
+    char *resp_msg;
+    size_t resp_sz;
+} transfer_data;
+
+int transfer_modifier(account_rec_t *from, account_rec_t *to, void *data) {
+    transfer_data *d = (transfer_data*)data;
+    char bal[MONEY_STR_LEN];
+    if (to->active == STATUS_INACTIVE) {
+        snprintf(d->resp_msg, d->resp_sz, "Transfer Failed: Recipient account not found or is inactive");
+        return 0;
+    }
+    if (from->active == STATUS_INACTIVE) {
+        snprintf(d->resp_msg, d->resp_sz, "Transfer Failed: Sender account is inactive");
+        return 0;
+    }
+    if (from->balance < d->amount) {
+        snprintf(d->resp_msg, d->resp_sz, "Transfer Failed: Insufficient Balance (Current: %s)", money_format(from->balance, bal, sizeof(bal)));
+        return 0;
+    }
+    if (to->balance > MONEY_MAX - d->amount) {
+        snprintf(d->resp_msg, d->resp_sz, "Transfer Failed: Recipient account error");
+        return 0;   // Would overflow
+    }
+    from->balance -= d->amount;
+    to->balance += d->amount;
+    return 1;
+}
+
+// transfer_funds (Atomic: both balances change under one two-record lock, both legs logged together)
+int transfer_funds(uint32_t from_id, uint32_t to_id, money_t amount, char *resp_msg, size_t resp_sz) {
     if (from_id == to_id) {
          snprintf(resp_msg, resp_sz, "Cannot transfer to the same account.");
          return 0;
@@ -143,56 +188,114 @@ int transfer_funds(uint32_t from_id, uint32_t to_id, double amount, char *resp_m
         return 0;
     }
 
-    txn_data_t withdraw_data = {amount};
-    txn_data_t deposit_data = {amount};
-
-    // 1. Check receiver account exists and is active first
-    account_rec_t to_acc;
-    if (!read_account(to_id, &to_acc) || to_acc.active == STATUS_INACTIVE) {
-        snprintf(resp_msg, resp_sz, "Transfer Failed: Recipient account not found or is inactive");
+    resp_msg[0] = '\0';
+    transfer_data data = {amount, resp_msg, resp_sz};
+    time_t now = time(NULL);
+    txn_rec_t legs[2] = {
+        {0, from_id, to_id, amount, now, TXN_TRANSFER_OUT},
+        {0, from_id, to_id, amount, now, TXN_TRANSFER_IN},
+    };
+    txn_rows_t log = {legs, 2};     // Committed with the balances through the redo log
+    if (!atomic_update_account_pair(from_id, to_id, transfer_modifier, &data, &log)) {
+        if (resp_msg[0] == '\0') {
+            // The modifier never ran (one of the accounts does not exist) or the redo log failed
+            account_rec_t acc;
+            if (!read_account(to_id, &acc)) snprintf(resp_msg, resp_sz, "Transfer Failed: Recipient account not found or is inactive");
+            else if (!read_account(from_id, &acc)) snprintf(resp_msg, resp_sz, "Transfer Failed: Sender account not found");
+            else snprintf(resp_msg, resp_sz, "Transfer Failed: Could not record the transfer");
+        }
         return 0;
     }
 
+    char amt[MONEY_STR_LEN];
+    snprintf(resp_msg, resp_sz, "Transfer Successful: %s from %u to %u", money_format(amount, amt, sizeof(amt)), from_id, to_id);
+    return 1;
+}
 
-    // 2. Attempt to withdraw from sender (This is now RECORD locked)
-    if (!atomic_update_account(from_id, withdraw_modifier, &withdraw_data)) {
-        // Withdrawal failed, check why
-        account_rec_t from_acc;
-        if (!read_account(from_id, &from_acc)) snprintf(resp_msg, resp_sz, "Transfer Failed: Sender account not found");
-        else if (from_acc.active == STATUS_INACTIVE) snprintf(resp_msg, resp_sz, "Transfer Failed: Sender account is inactive");
-        else if (from_acc.balance < amount) snprintf(resp_msg, resp_sz, "Transfer Failed: Insufficient Balance (Current: %.2lf)", from_acc.balance);
-        else snprintf(resp_msg, resp_sz, "Transfer Failed: Sender account error");
-        return 0;
+/* --- Modifier for batch_transfer (source and every destination locked in one pass) --- */
+typedef struct {
+    const batch_transfer_item_t *items;
+    int count;
+    int ran;
+    uint64_t applied;       // Bit i set = item i applied
+    money_t moved;
+    char failures[MAX_MSG_LEN];
+    txn_rows_t log;         // Both legs of every applied item
+    time_t now;
+} batch_transfer_data;
+
+// Items are applied in request order; a failed item is skipped and the rest go ahead
+int batch_transfer_modifier(account_rec_t *from, account_rec_t **to, void *data) {
+    batch_transfer_data *d = (batch_transfer_data*)data;
+    d->ran = 1;
+    for (int i = 0; i < d->count; i++) {
+        money_t amount = d->items[i].amount;
+        const char *why = NULL;
+        if (amount <= 0) why = "amount must be positive";
+        else if (to[i] == from) why = "same account";
+        else if (to[i] == NULL || to[i]->active == STATUS_INACTIVE) why = "recipient not found or inactive";
+        else if (from->active == STATUS_INACTIVE) why = "sender account is inactive";
+        else if (from->balance < amount) why = "insufficient balance";
+        else if (to[i]->balance > MONEY_MAX - amount) why = "recipient account error";
+
+        if (why != NULL) {
+            char tmp[96];
+            snprintf(tmp, sizeof(tmp), "  #%d -> %u: %s\n", i + 1, d->items[i].to_id, why);
+            strncat(d->failures, tmp, sizeof(d->failures) - strlen(d->failures) - 1);
+            continue;
+        }
+        from->balance -= amount;
+        to[i]->balance += amount;
+        d->applied |= 1ULL << i;
+        d->moved += amount;
+        d->log.rows[d->log.count++] = (txn_rec_t){0, from->account_id, d->items[i].to_id, amount, d->now, TXN_TRANSFER_OUT};
+        d->log.rows[d->log.count++] = (txn_rec_t){0, from->account_id, d->items[i].to_id, amount, d->now, TXN_TRANSFER_IN};
     }
+    return d->applied != 0;
+}
 
-    // 3. Attempt to deposit to receiver (This is now RECORD locked)
-    if (!atomic_update_account(to_id, deposit_modifier, &deposit_data)) {
-        snprintf(resp_msg, resp_sz, "CRITICAL ERROR: Transfer failed after withdrawal. Contact support.");
-        // Rollback: Deposit the money back to the sender
-        atomic_update_account(from_id, deposit_modifier, &withdraw_data);
+// batch_transfer (Bulk payout: one lock pass over all accounts, one log write for every leg)
+int batch_transfer(uint32_t from_id, const batch_transfer_item_t *items, int count, char *resp_msg, size_t resp_sz) {
+    if (count < 1 || count > MAX_BATCH_TRANSFER_ITEMS) {
+        snprintf(resp_msg, resp_sz, "Batch Transfer Failed: 1 to %d items per request", MAX_BATCH_TRANSFER_ITEMS);
         return 0;
     }
-    
-    // 4. Log transactions
-    time_t now = time(NULL);
-    txn_rec_t tx1 = {0, from_id, to_id, amount, now, "transfer_out"};
-    append_transaction(&tx1);
 
-    txn_rec_t tx2 = {0, from_id, to_id, amount, now, "transfer_in"};
-    append_transaction(&tx2);
+    uint32_t to_ids[MAX_BATCH_TRANSFER_ITEMS];
+    for (int i = 0; i < count; i++) to_ids[i] = items[i].to_id;
+    txn_rec_t legs[2 * MAX_BATCH_TRANSFER_ITEMS];
+    batch_transfer_data data = {items, count, 0, 0, 0, "", {legs, 0}, time(NULL)};
+    int committed = atomic_update_account_batch(from_id, to_ids, count, batch_transfer_modifier, &data, &data.log);
+    if (!data.ran) {
+        snprintf(resp_msg, resp_sz, "Batch Transfer Failed: Sender account not found");
+        return 0;
+    }
+    if (data.applied != 0 && !committed) {
+        snprintf(resp_msg, resp_sz, "Batch Transfer Failed: Could not record the transfers");
+        return 0;
+    }
 
-    snprintf(resp_msg, resp_sz, "Transfer Successful: %.2lf from %u to %u", amount, from_id, to_id);
-    return 1;
+    // Result bitmap: bit i (least significant first) is item i + 1
+    int applied_count = __builtin_popcountll(data.applied);
+    char amt[MONEY_STR_LEN];
+    snprintf(resp_msg, resp_sz, "Batch Transfer: %d of %d applied, %s sent from %u\nResult bitmap: %0*llx\n",
+             applied_count, count, money_format(data.moved, amt, sizeof(amt)), from_id,
+             (count + 3) / 4, (unsigned long long)data.applied);
+    if (data.failures[0] != '\0') {
+        strncat(resp_msg, "Failed items:\n", resp_sz - strlen(resp_msg) - 1);
+        strncat(resp_msg, data.failures, resp_sz - strlen(resp_msg) - 1);
+    }
+    return applied_count == count;
 }
 
 // apply_loan (Atomic append)
-int apply_loan(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz) {
+int apply_loan(uint32_t user_id, money_t amount, char *resp_msg, size_t resp_sz) {
     if (amount <= 0) {
         snprintf(resp_msg, resp_sz, "Loan amount must be positive.");
         return 0;
     }
     
-    loan_rec_t loan = {0, user_id, amount, LOAN_PENDING, 0, time(NULL), 0, ""};
+    loan_rec_t loan = { .user_id = user_id, .amount = amount, .status = LOAN_PENDING, .applied_at = time(NULL) };
     if(append_loan(&loan)) {
         snprintf(resp_msg, resp_sz, "Loan Application Submitted (ID: %llu)", (unsigned long long)loan.loan_id);
         return 1;
@@ -201,31 +304,30 @@ int apply_loan(uint32_t user_id, double amount, char *resp_msg, size_t resp_sz)
     return 0;
 }
 
-// view_loan_status (Read-only list)
-int view_loan_status(uint32_t user_id, char *resp_msg, size_t resp_sz) {
-    int fd = open(LOANS_DB_FILE, O_RDONLY);
-    if(fd < 0) { snprintf(resp_msg, resp_sz, "No loan records found"); return 0; }
-    
-    lock_file(fd); 
-    loan_rec_t loan;
-    char tmp[512]; 
-    resp_msg[0] = '\0'; 
-    int found = 0;
-    
+/* --- Visitor for view_loan_status (the applicant's loans, in id order) --- */
+typedef struct {
+    char *resp_msg;
+    size_t resp_sz;
+} loan_list_data;
+
+int loan_status_visitor(const loan_rec_t *loan, void *data) {
+    loan_list_data *d = (loan_list_data*)data;
     const char *status_map[] = {"PENDING", "ASSIGNED", "APPROVED", "REJECTED"};
+    char tmp[512]; 
+    char amt[MONEY_STR_LEN];
+    snprintf(tmp, sizeof(tmp), "ID: %llu, Amount: %s, Status: %s\n",
+             (unsigned long long)loan->loan_id, money_format(loan->amount, amt, sizeof(amt)), 
+             status_map[loan->status]);
+    strncat(d->resp_msg, tmp, d->resp_sz - strlen(d->resp_msg) - 1);
+    return 1;
+}
 
-    while(read(fd, &loan, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
-        if(loan.user_id == user_id) {
-            snprintf(tmp, sizeof(tmp), "ID: %llu, Amount: %.2lf, Status: %s\n",
-                     (unsigned long long)loan.loan_id, loan.amount, 
-                     status_map[loan.status]);
-            strncat(resp_msg, tmp, resp_sz - strlen(resp_msg) - 1);
-            found = 1;
-        }
-    }
-    
-    unlock_file(fd);
-    close(fd);
+// view_loan_status (Read-only list via the applicant index)
+int view_loan_status(uint32_t user_id, char *resp_msg, size_t resp_sz) {
+    resp_msg[0] = '\0'; 
+    loan_list_data data = {resp_msg, resp_sz};
+    int found = for_each_loan(LOAN_BY_APPLICANT, user_id, loan_status_visitor, &data);
+    if (found < 0) { snprintf(resp_msg, resp_sz, "No loan records found"); return 0; }
     
     if (!found) {
         snprintf(resp_msg, resp_sz, "No loan applications found for your ID.");
@@ -245,102 +347,111 @@ int add_feedback(uint32_t user_id, const char *msg, char *resp_msg, size_t resp_
     return 0;
 }
 
+/* --- Visitor for view_feedback_status (feedback.db in file order) --- */
+typedef struct {
+    uint32_t user_id;
+    char *resp_msg;
+    size_t resp_sz;
+    int found;
+} feedback_list_data;
+
+int feedback_status_visitor(const feedback_rec_t *fb, void *data) {
+    feedback_list_data *d = (feedback_list_data*)data;
+    if (fb->user_id != d->user_id) return 1;
+    char tmp[512]; 
+    snprintf(tmp, sizeof(tmp), "ID: %llu, Status: %s, Msg: \"%s\"\n",
+             (unsigned long long)fb->fb_id, 
+             fb->reviewed ? "REVIEWED" : "PENDING",
+             fb->message);
+    strncat(d->resp_msg, tmp, d->resp_sz - strlen(d->resp_msg) - 1);
+    d->found = 1;
+    return 1;
+}
+
 // view_feedback_status (Read-only list)
 int view_feedback_status(uint32_t user_id, char *resp_msg, size_t resp_sz) {
-    int fd = open(FEEDBACK_DB_FILE, O_RDONLY);
-    if(fd < 0) { snprintf(resp_msg, resp_sz, "No feedback records found"); return 0; }
-    
-    lock_file(fd); 
-    feedback_rec_t fb;
-    char tmp[512]; 
     resp_msg[0] = '\0';
-    int found = 0;
-    
-    while(read(fd, &fb, sizeof(feedback_rec_t)) == sizeof(feedback_rec_t)) {
-        if(fb.user_id == user_id) {
-            snprintf(tmp, sizeof(tmp), "ID: %llu, Status: %s, Msg: \"%s\"\n",
-                     (unsigned long long)fb.fb_id, 
-                     fb.reviewed ? "REVIEWED" : "PENDING",
-                     fb.message);
-            strncat(resp_msg, tmp, resp_sz - strlen(resp_msg) - 1);
-            found = 1;
-        }
+    feedback_list_data data = {user_id, resp_msg, resp_sz, 0};
+    if (for_each_feedback(feedback_status_visitor, &data) < 0) {
+        snprintf(resp_msg, resp_sz, "No feedback records found");
+        return 0;
     }
     
-    unlock_file(fd);
-    close(fd);
-    
-    if (!found) {
+    if (!data.found) {
         snprintf(resp_msg, resp_sz, "No feedback submitted by your ID.");
     }
     return 1;
 }
 
-// view_transaction_history (Read-only list, reads backward)
-int view_transaction_history(uint32_t user_id, char *resp_msg, size_t resp_sz) {
-    int fd = open(TRANSACTIONS_DB_FILE, O_RDONLY);
-    if(fd < 0) { snprintf(resp_msg, resp_sz, "No transaction history found"); return 0; }
+/* --- Visitor for view_transaction_history (rows arrive newest first) --- */
+typedef struct {
+    uint32_t user_id;
+    char *resp_msg;
+    size_t resp_sz;
+    int found;
+} history_data;
+
+int history_visitor(const txn_rec_t *tx, void *data) {
+    history_data *d = (history_data*)data;
+    uint32_t user_id = d->user_id;
+    char tmp[256];
+
+    char time_str[64];
+    struct tm *tm_info = localtime(&tx->timestamp);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
     
-    lock_file(fd); // Full file lock is fine for read-only list
-    txn_rec_t tx;
-    char tmp[256]; 
-    resp_msg[0] = '\0';
-    int found = 0;
+    char type_str[16];
+    uint32_t other_id = 0;
+    int tx_is_relevant = 0; // Flag to mark if this TXN should be shown
+
+    if (tx->type == TXN_DEPOSIT && tx->to_account == user_id) {
+        strcpy(type_str, "DEPOSIT");
+        other_id = 0;
+        tx_is_relevant = 1;
+    
+    } else if (tx->type == TXN_WITHDRAW && tx->from_account == user_id) {
+        strcpy(type_str, "WITHDRAW");
+        other_id = 0;
+        tx_is_relevant = 1;
     
+    } else if (tx->type == TXN_TRANSFER_OUT && tx->from_account == user_id) {
+        strcpy(type_str, "TRANSFER_OUT");
+        other_id = tx->to_account;
+        tx_is_relevant = 1;
+
+    } else if (tx->type == TXN_TRANSFER_IN && tx->to_account == user_id) {
+        strcpy(type_str, "TRANSFER_IN");
+        other_id = tx->from_account;
+        tx_is_relevant = 1;
+    
+    } else if (tx->type == TXN_LOAN_DEPOSIT && tx->to_account == user_id) {
+        strcpy(type_str, "LOAN_DEPOSIT");
+        other_id = 0; // Bank is the sender
+        tx_is_relevant = 1;
+    }
+
+    if(tx_is_relevant) {
+        d->found = 1;
+        char amt[MONEY_STR_LEN];
+        snprintf(tmp, sizeof(tmp), "%-11s | %-8s | %-10u | %s\n",
+                 type_str, money_format(tx->amount, amt, sizeof(amt)), other_id, time_str);
+        strncat(d->resp_msg, tmp, d->resp_sz - strlen(d->resp_msg) - 1);
+    }
+    return strlen(d->resp_msg) + 1 < d->resp_sz; // Stop once the response is full
+}
+
+// view_transaction_history (Read-only list, follows the account's posting chain newest first)
+int view_transaction_history(uint32_t user_id, char *resp_msg, size_t resp_sz) {
+    resp_msg[0] = '\0';
     strncat(resp_msg, "Type        | Amount   | Other Acct | Timestamp\n", resp_sz - 1);
     strncat(resp_msg, "------------|----------|------------|-------------------\n", resp_sz - 1);
 
-    // Read file from end to beginning to show most recent first
-    off_t offset = lseek(fd, -sizeof(txn_rec_t), SEEK_END);
-    while(offset >= 0) {
-        if(read(fd, &tx, sizeof(txn_rec_t)) != sizeof(txn_rec_t)) break;
-        
-        char time_str[64];
-        struct tm *tm_info = localtime(&tx.timestamp);
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-        
-        char type_str[16];
-        uint32_t other_id = 0;
-        int tx_is_relevant = 0; // Flag to mark if this TXN should be shown
-
-        if (strcmp(tx.narration, "deposit") == 0 && tx.to_account == user_id) {
-            strcpy(type_str, "DEPOSIT");
-            other_id = 0;
-            tx_is_relevant = 1;
-        
-        } else if (strcmp(tx.narration, "withdraw") == 0 && tx.from_account == user_id) {
-            strcpy(type_str, "WITHDRAW");
-            other_id = 0;
-            tx_is_relevant = 1;
-        
-        } else if (strcmp(tx.narration, "transfer_out") == 0 && tx.from_account == user_id) {
-            strcpy(type_str, "TRANSFER_OUT");
-            other_id = tx.to_account;
-            tx_is_relevant = 1;
-
-        } else if (strcmp(tx.narration, "transfer_in") == 0 && tx.to_account == user_id) {
-            strcpy(type_str, "TRANSFER_IN");
-            other_id = tx.from_account;
-            tx_is_relevant = 1;
-        
-        } else if (strcmp(tx.narration, "loan_deposit") == 0 && tx.to_account == user_id) {
-            strcpy(type_str, "LOAN_DEPOSIT");
-            other_id = 0; // Bank is the sender
-            tx_is_relevant = 1;
-        }
-
-        if(tx_is_relevant) {
-            found = 1;
-            snprintf(tmp, sizeof(tmp), "%-11s | %-8.2f | %-10u | %s\n",
-                     type_str, tx.amount, other_id, time_str);
-            strncat(resp_msg, tmp, resp_sz - strlen(resp_msg) - 1);
-        }
-        
-        offset = lseek(fd, -2 * sizeof(txn_rec_t), SEEK_CUR); // Move back two records
+    history_data data = {user_id, resp_msg, resp_sz, 0};
+    if (txn_log_history(user_id, history_visitor, &data) < 0) {
+        snprintf(resp_msg, resp_sz, "No transaction history found");
+        return 0;
     }
-    
-    unlock_file(fd);
-    close(fd);
+    int found = data.found;
     
     if (!found) {
         snprintf(resp_msg, resp_sz, "No transaction history found for your ID.");
@@ -0,0 +1,337 @@
+#include "db_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * --- IN-MEMORY INDEX MODULE (Hash tables over .db record offsets) ---
+ * Not thread-safe by itself: callers guard each index with their own lock (bloom filters
+ * only need their adds serialised).
+ */
+
+#define ID_INDEX_MIN_CAPACITY 64
+
+// 64-bit mixer (splitmix64 finalizer) so dense IDs spread across the table
+static uint64_t hash_u64(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+static size_t round_up_pow2(size_t n) {
+    size_t cap = ID_INDEX_MIN_CAPACITY;
+    while (cap < n) cap <<= 1;
+    return cap;
+}
+
+int id_index_init(id_index_t *idx, size_t capacity_hint) {
+    idx->capacity = round_up_pow2(capacity_hint * 2);   // Keep load factor <= 0.5
+    idx->count = 0;
+    idx->slots = calloc(idx->capacity, sizeof(id_index_slot_t));
+    return idx->slots != NULL;
+}
+
+void id_index_free(id_index_t *idx) {
+    free(idx->slots);
+    idx->slots = NULL;
+    idx->capacity = idx->count = 0;
+}
+
+int64_t id_index_get(const id_index_t *idx, uint64_t key) {
+    if (key == 0 || idx->slots == NULL) return -1;
+    size_t mask = idx->capacity - 1;
+    size_t i = hash_u64(key) & mask;
+    while (idx->slots[i].key != 0) {
+        if (idx->slots[i].key == key) return idx->slots[i].value;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+// Double the table and re-insert every live slot
+static int id_index_grow(id_index_t *idx) {
+    id_index_t bigger;
+    bigger.capacity = idx->capacity * 2;
+    bigger.count = 0;
+    bigger.slots = calloc(bigger.capacity, sizeof(id_index_slot_t));
+    if (bigger.slots == NULL) return 0;
+    for (size_t i = 0; i < idx->capacity; i++) {
+        if (idx->slots[i].key != 0) {
+            id_index_put(&bigger, idx->slots[i].key, idx->slots[i].value);
+        }
+    }
+    free(idx->slots);
+    *idx = bigger;
+    return 1;
+}
+
+int id_index_put(id_index_t *idx, uint64_t key, int64_t value) {
+    if (key == 0) return 0;
+    if (idx->slots == NULL && !id_index_init(idx, 0)) return 0;
+    if ((idx->count + 1) * 2 > idx->capacity && !id_index_grow(idx)) return 0;
+    size_t mask = idx->capacity - 1;
+    size_t i = hash_u64(key) & mask;
+    while (idx->slots[i].key != 0) {
+        if (idx->slots[i].key == key) {
+            idx->slots[i].value = value;
+            return 1;
+        }
+        i = (i + 1) & mask;
+    }
+    idx->slots[i].key = key;
+    idx->slots[i].value = value;
+    idx->count++;
+    return 1;
+}
+
+// Remove 'key', shifting later slots of its probe run back so no tombstone is left
+int id_index_del(id_index_t *idx, uint64_t key) {
+    if (key == 0 || idx->slots == NULL) return 0;
+    size_t mask = idx->capacity - 1;
+    size_t i = hash_u64(key) & mask;
+    while (idx->slots[i].key != key) {
+        if (idx->slots[i].key == 0) return 0;
+        i = (i + 1) & mask;
+    }
+    for (size_t j = (i + 1) & mask; idx->slots[j].key != 0; j = (j + 1) & mask) {
+        size_t home = hash_u64(idx->slots[j].key) & mask;
+        // Leave it if its home lies cyclically in (i, j]: the hole does not break its run
+        int stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays) continue;
+        idx->slots[i] = idx->slots[j];
+        i = j;
+    }
+    idx->slots[i].key = 0;
+    idx->slots[i].value = 0;
+    idx->count--;
+    return 1;
+}
+
+/* --- STRING KEY INDEX --- */
+
+char str_index_tombstone[1];
+
+// FNV-1a over the NUL-terminated key
+static uint64_t hash_str(const char *key) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (*key) {
+        h ^= (unsigned char)*key++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int slot_is_live(const str_index_slot_t *slot) {
+    return slot->key != NULL && slot->key != STR_INDEX_TOMBSTONE;
+}
+
+int str_index_init(str_index_t *idx, size_t capacity_hint) {
+    idx->capacity = round_up_pow2(capacity_hint * 2);
+    idx->count = idx->used = 0;
+    idx->slots = calloc(idx->capacity, sizeof(str_index_slot_t));
+    return idx->slots != NULL;
+}
+
+void str_index_free(str_index_t *idx) {
+    for (size_t i = 0; i < idx->capacity; i++) {
+        if (slot_is_live(&idx->slots[i])) free(idx->slots[i].key);
+    }
+    free(idx->slots);
+    idx->slots = NULL;
+    idx->capacity = idx->count = idx->used = 0;
+}
+
+// Slot holding 'key', or -1 (tombstones are probed past, never matched)
+static long str_index_find(const str_index_t *idx, const char *key, uint64_t h) {
+    size_t mask = idx->capacity - 1;
+    size_t i = h & mask;
+    while (idx->slots[i].key != NULL) {
+        if (slot_is_live(&idx->slots[i]) && idx->slots[i].hash == h && strcmp(idx->slots[i].key, key) == 0) {
+            return (long)i;
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+int64_t str_index_get(const str_index_t *idx, const char *key) {
+    if (key == NULL || idx->slots == NULL) return -1;
+    long i = str_index_find(idx, key, hash_str(key));
+    return (i < 0) ? -1 : idx->slots[i].value;
+}
+
+// Rehash live keys into a table sized for them (drops tombstones; keys are re-linked, not copied)
+static int str_index_rehash(str_index_t *idx) {
+    size_t capacity = idx->capacity;
+    if ((idx->count + 1) * 2 > capacity) capacity *= 2;
+    str_index_slot_t *slots = calloc(capacity, sizeof(str_index_slot_t));
+    if (slots == NULL) return 0;
+    for (size_t i = 0; i < idx->capacity; i++) {
+        if (!slot_is_live(&idx->slots[i])) continue;
+        size_t j = idx->slots[i].hash & (capacity - 1);
+        while (slots[j].key != NULL) j = (j + 1) & (capacity - 1);
+        slots[j] = idx->slots[i];
+    }
+    free(idx->slots);
+    idx->slots = slots;
+    idx->capacity = capacity;
+    idx->used = idx->count;
+    return 1;
+}
+
+int str_index_put(str_index_t *idx, const char *key, int64_t value) {
+    if (key == NULL) return 0;
+    if (idx->slots == NULL && !str_index_init(idx, 0)) return 0;
+    uint64_t h = hash_str(key);
+    long found = str_index_find(idx, key, h);
+    if (found >= 0) {
+        idx->slots[found].value = value;
+        return 1;
+    }
+    if ((idx->used + 1) * 2 > idx->capacity && !str_index_rehash(idx)) return 0;
+    size_t mask = idx->capacity - 1;
+    size_t i = h & mask;
+    while (slot_is_live(&idx->slots[i])) i = (i + 1) & mask;   // Reuse first empty/tombstone
+    char *copy = strdup(key);
+    if (copy == NULL) return 0;
+    if (idx->slots[i].key == NULL) idx->used++;
+    idx->slots[i].hash = h;
+    idx->slots[i].key = copy;
+    idx->slots[i].value = value;
+    idx->count++;
+    return 1;
+}
+
+int str_index_del(str_index_t *idx, const char *key) {
+    if (key == NULL || idx->slots == NULL) return 0;
+    long i = str_index_find(idx, key, hash_str(key));
+    if (i < 0) return 0;
+    free(idx->slots[i].key);
+    idx->slots[i].key = STR_INDEX_TOMBSTONE;
+    idx->count--;
+    return 1;
+}
+
+/* --- MULTI-VALUE INDEX --- */
+
+void id_multi_free(id_multi_index_t *idx) {
+    for (size_t i = 0; i < idx->count; i++) free(idx->lists[i].ids);
+    free(idx->lists);
+    id_index_free(&idx->lookup);
+    idx->lists = NULL;
+    idx->count = idx->capacity = 0;
+}
+
+// Keys are shifted by one because 0 marks an empty slot in the lookup table
+const id_list_t *id_multi_get(const id_multi_index_t *idx, uint64_t key) {
+    int64_t pos = id_index_get(&idx->lookup, key + 1);
+    return (pos < 0) ? NULL : &idx->lists[pos];
+}
+
+// First position in 'list' whose id is >= 'id'
+static size_t id_list_lower_bound(const id_list_t *list, uint64_t id) {
+    size_t lo = 0, hi = list->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list->ids[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int id_multi_add(id_multi_index_t *idx, uint64_t key, uint64_t id) {
+    int64_t pos = id_index_get(&idx->lookup, key + 1);
+    if (pos < 0) {
+        if (idx->count == idx->capacity) {
+            size_t capacity = idx->capacity ? idx->capacity * 2 : 8;
+            id_list_t *lists = realloc(idx->lists, capacity * sizeof(id_list_t));
+            if (lists == NULL) return 0;
+            idx->lists = lists;
+            idx->capacity = capacity;
+        }
+        if (!id_index_put(&idx->lookup, key + 1, idx->count)) return 0;
+        pos = idx->count++;
+        memset(&idx->lists[pos], 0, sizeof(id_list_t));
+    }
+
+    id_list_t *list = &idx->lists[pos];
+    size_t at = (list->count > 0 && list->ids[list->count - 1] < id)
+                ? list->count                       // Common case: ids arrive in order
+                : id_list_lower_bound(list, id);
+    if (at < list->count && list->ids[at] == id) return 1;
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        uint64_t *ids = realloc(list->ids, capacity * sizeof(uint64_t));
+        if (ids == NULL) return 0;
+        list->ids = ids;
+        list->capacity = capacity;
+    }
+    memmove(&list->ids[at + 1], &list->ids[at], (list->count - at) * sizeof(uint64_t));
+    list->ids[at] = id;
+    list->count++;
+    return 1;
+}
+
+int id_multi_del(id_multi_index_t *idx, uint64_t key, uint64_t id) {
+    int64_t pos = id_index_get(&idx->lookup, key + 1);
+    if (pos < 0) return 0;
+    id_list_t *list = &idx->lists[pos];
+    size_t at = id_list_lower_bound(list, id);
+    if (at == list->count || list->ids[at] != id) return 0;
+    memmove(&list->ids[at], &list->ids[at + 1], (list->count - at - 1) * sizeof(uint64_t));
+    list->count--;
+    return 1;
+}
+
+/* --- BLOOM FILTER --- */
+
+int bloom_init(bloom_filter_t *f, size_t capacity_hint) {
+    f->capacity = capacity_hint > BLOOM_MIN_KEYS ? capacity_hint : BLOOM_MIN_KEYS;
+    f->bits = 64;
+    while (f->bits < (uint64_t)f->capacity * BLOOM_BITS_PER_KEY) f->bits <<= 1;
+    f->count = 0;
+    atomic_init(&f->set_bits, 0);
+    f->words = calloc(f->bits / 64, sizeof(uint64_t));
+    return f->words != NULL;
+}
+
+void bloom_free(bloom_filter_t *f) {
+    free((void *)f->words);
+    f->words = NULL;
+    f->bits = 0;
+    f->capacity = f->count = 0;
+}
+
+// Double hashing: probe i is h1 + i * h2 (h2 odd, so the probes never collapse)
+#define bloom_probe(f, h1, h2, i) (((h1) + (uint64_t)(i) * (h2)) & ((f)->bits - 1))
+
+void bloom_add(bloom_filter_t *f, const char *key) {
+    uint64_t h1 = hash_str(key), h2 = hash_u64(h1) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = bloom_probe(f, h1, h2, i);
+        uint64_t mask = 1ULL << (bit & 63);
+        if (!(atomic_fetch_or_explicit(&f->words[bit >> 6], mask, memory_order_relaxed) & mask)) {
+            atomic_fetch_add_explicit(&f->set_bits, 1, memory_order_relaxed);
+        }
+    }
+    f->count++;
+}
+
+int bloom_may_contain(const bloom_filter_t *f, const char *key) {
+    uint64_t h1 = hash_str(key), h2 = hash_u64(h1) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = bloom_probe(f, h1, h2, i);
+        if (!(atomic_load_explicit(&f->words[bit >> 6], memory_order_relaxed) & (1ULL << (bit & 63)))) return 0;
+    }
+    return 1;
+}
+
+// An absent key passes only if all of its probes hit set bits: fill ^ BLOOM_HASHES
+double bloom_false_positive_rate(const bloom_filter_t *f) {
+    if (f->bits == 0) return 0.0;
+    double fill = (double)atomic_load(&f->set_bits) / (double)f->bits, rate = 1.0;
+    for (int i = 0; i < BLOOM_HASHES; i++) rate *= fill;
+    return rate;
+}
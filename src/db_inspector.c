@@ -7,6 +7,7 @@
 #include <string.h>
 #include <time.h>
 #include "server.h" // Includes all struct and file path definitions
+#include "txn_archive.h"
 
 /* --- Helper function to print time neatly --- */
 void print_timestamp(time_t t, const char* label) {
@@ -42,6 +43,34 @@ const char* get_loan_status_str(loan_status_t status) {
     }
 }
 
+/* --- Helper for Transaction Type Enum --- */
+const char* get_txn_type_str(uint8_t type) {
+    switch(type) {
+        case TXN_DEPOSIT:      return "deposit";
+        case TXN_WITHDRAW:     return "withdraw";
+        case TXN_TRANSFER_OUT: return "transfer_out";
+        case TXN_TRANSFER_IN:  return "transfer_in";
+        case TXN_LOAN_DEPOSIT: return "loan_deposit";
+        default:               return "unknown";
+    }
+}
+
+/* --- Helper to open a db file under a shared fcntl lock --- */
+// Waits out the server's exclusive table operations (appends, batch updates);
+// the lock is released when the descriptor is closed.
+int open_for_dump(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_RDLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    fcntl(fd, F_SETLKW, &lock);
+    return fd;
+}
+
 
 /* --- Main Dump Functions --- */
 
@@ -50,7 +79,7 @@ void print_users() {
     printf("  DUMPING USERS (from %s)\n", USERS_DB_FILE);
     printf("==========================================\n");
 
-    int fd = open(USERS_DB_FILE, O_RDONLY);
+    int fd = open_for_dump(USERS_DB_FILE);
     if (fd < 0) {
         perror("Could not open users.db");
         return;
@@ -80,67 +109,193 @@ void print_accounts() {
     printf("  DUMPING ACCOUNTS (from %s)\n", ACCOUNTS_DB_FILE);
     printf("==========================================\n");
 
-    int fd = open(ACCOUNTS_DB_FILE, O_RDONLY);
+    int fd = open_for_dump(ACCOUNTS_DB_FILE);
     if (fd < 0) {
         perror("Could not open accounts.db");
         return;
     }
 
     account_rec_t acc;
+    char amt[MONEY_STR_LEN];
     int count = 1;
     while (read(fd, &acc, sizeof(account_rec_t)) == sizeof(account_rec_t)) {
+        if (acc.account_id == ACCOUNT_SLOT_EMPTY) continue;    // Unused slot (staff ID / hole)
         printf("\n--- Account Record %d ---\n", count++);
         printf("  Account ID:   %u\n", acc.account_id);
         printf("  User ID:      %u\n", acc.user_id);
-        printf("  Balance:      %.2f\n", acc.balance);
+        printf("  Balance:      %s\n", money_format(acc.balance, amt, sizeof(amt)));
         printf("  Acct Status:  %s\n", acc.active == STATUS_ACTIVE ? "ACTIVE" : "INACTIVE");
     }
     close(fd);
 }
 
+void print_disk_txn(int count, const txn_disk_rec_t *tx, int64_t base_time) {
+    char amt[MONEY_STR_LEN];
+    printf("\n--- Transaction Record %d ---\n", count);
+    printf("  Txn ID:       %llu\n", (unsigned long long)tx->txn_id);
+    printf("  From Acct:    %u\n", tx->from_account);
+    printf("  To Acct:      %u\n", tx->to_account);
+    printf("  Amount:       %s\n", money_format(tx->amount, amt, sizeof(amt)));
+    printf("  Narration:    %s\n", get_txn_type_str(tx->type));
+    print_timestamp((time_t)(base_time + tx->time_delta), "  Timestamp");
+}
+
+// Row N of the log: archived rows come from txn_archive.db (their hot copies may be holes)
+int read_stored_row(int fd, uint64_t row, txn_disk_rec_t *tx) {
+    if (row < txn_archive_rows()) return txn_archive_read(row, 1, tx) == 1;
+    return pread(fd, tx, sizeof(*tx), (off_t)(row + 1) * TXN_DISK_REC_SIZE) == sizeof(*tx);
+}
+
+/* --- Segment footers (txn_segments.db) --- */
+// Reads every sealed segment's footer; returns the count (0 if there are none)
+int load_segments(txn_segment_t **out) {
+    *out = NULL;
+    int fd = open_for_dump(TXN_SEGMENTS_DB_FILE);
+    if (fd < 0) return 0;
+    off_t size = lseek(fd, 0, SEEK_END);
+    int count = (int)(size / (off_t)sizeof(txn_segment_t));
+    *out = malloc((count ? count : 1) * sizeof(txn_segment_t));
+    if (*out == NULL || pread(fd, *out, count * sizeof(txn_segment_t), 0) != (ssize_t)(count * sizeof(txn_segment_t))) {
+        count = 0;
+    }
+    close(fd);
+    return count;
+}
+
+void print_segments(txn_segment_t *segs, int count) {
+    uint64_t open_from = count ? segs[count - 1].first_row + segs[count - 1].rows : 0;
+    printf("  Segments:     %d sealed (%s), open segment from record %llu\n",
+           count, TXN_SEGMENTS_DB_FILE, (unsigned long long)open_from + 1);
+    for (int i = 0; i < count; i++) {
+        char from[32], to[32];
+        time_t t = (time_t)segs[i].min_time;
+        strftime(from, sizeof(from), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        t = (time_t)segs[i].max_time;
+        strftime(to, sizeof(to), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        printf("    #%d: records %llu-%llu, %s .. %s UTC, txn IDs %llu-%llu\n", i + 1,
+               (unsigned long long)segs[i].first_row + 1, (unsigned long long)(segs[i].first_row + segs[i].rows),
+               from, to, (unsigned long long)segs[i].min_txn_id, (unsigned long long)segs[i].max_txn_id);
+    }
+}
+
 void print_transactions() {
     printf("\n==========================================\n");
     printf("  DUMPING TRANSACTIONS (from %s)\n", TRANSACTIONS_DB_FILE);
     printf("==========================================\n");
 
-    int fd = open(TRANSACTIONS_DB_FILE, O_RDONLY);
+    int fd = open_for_dump(TRANSACTIONS_DB_FILE);
     if (fd < 0) {
         perror("Could not open transactions.db");
         return;
     }
 
-    txn_rec_t tx;
+    txn_file_header_t hdr;
     int count = 1;
-    while (read(fd, &tx, sizeof(txn_rec_t)) == sizeof(txn_rec_t)) {
-        printf("\n--- Transaction Record %d ---\n", count++);
-        printf("  Txn ID:       %llu\n", (unsigned long long)tx.txn_id);
-        printf("  From Acct:    %u\n", tx.from_account);
-        printf("  To Acct:      %u\n", tx.to_account);
-        printf("  Amount:       %.2f\n", tx.amount);
-        printf("  Narration:    %s\n", tx.narration);
-        print_timestamp(tx.timestamp, "  Timestamp");
+    if (read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == TXN_FILE_MAGIC) {
+        printf("  Format:       compact v%u (%u-byte rows)\n", hdr.version, hdr.record_size);
+        print_timestamp((time_t)hdr.base_time, "  Base Time");
+        txn_segment_t *segs;
+        int seg_count = load_segments(&segs);
+        print_segments(segs, seg_count);
+        free(segs);
+        const txn_archive_stats_t *ar = txn_archive_stats();
+        if (ar->rows > 0) {
+            printf("  Archived:     records 1-%llu in %s (%llu bytes)\n", (unsigned long long)ar->rows,
+                   TXN_ARCHIVE_DB_FILE, (unsigned long long)ar->bytes);
+        }
+        txn_disk_rec_t tx;
+        for (uint64_t row = 0; read_stored_row(fd, row, &tx); row++) {
+            print_disk_txn(count++, &tx, hdr.base_time);
+        }
+    } else {
+        // Pre-v1 file (not yet converted by the server)
+        printf("  Format:       legacy (%zu-byte rows)\n", sizeof(txn_legacy_rec_t));
+        lseek(fd, 0, SEEK_SET);
+        txn_legacy_rec_t tx;
+        while (read(fd, &tx, sizeof(tx)) == sizeof(tx)) {
+            printf("\n--- Transaction Record %d ---\n", count++);
+            printf("  Txn ID:       %llu\n", (unsigned long long)tx.txn_id);
+            printf("  From Acct:    %u\n", tx.from_account);
+            printf("  To Acct:      %u\n", tx.to_account);
+            printf("  Amount:       %.2f\n", tx.amount);
+            printf("  Narration:    %s\n", tx.narration);
+            print_timestamp(tx.timestamp, "  Timestamp");
+        }
     }
     close(fd);
 }
 
+/* --- Date-range / per-account query (skips segments by their footers) --- */
+// Prints the rows in [from, to] that involve 'account' (0 = any account)
+int print_matching_rows(int fd, int64_t base_time, uint64_t first, uint64_t last,
+                        time_t from, time_t to, uint32_t account) {
+    int printed = 0;
+    txn_disk_rec_t tx;
+    for (uint64_t row = first; row < last; row++) {
+        if (!read_stored_row(fd, row, &tx)) break;
+        time_t t = (time_t)(base_time + tx.time_delta);
+        if (t < from || t > to) continue;
+        if (account && tx.from_account != account && tx.to_account != account) continue;
+        print_disk_txn((int)row + 1, &tx, base_time);
+        printed++;
+    }
+    return printed;
+}
+
+void query_transactions(time_t from, time_t to, uint32_t account) {
+    printf("\n==========================================\n");
+    printf("  QUERYING TRANSACTIONS (from %s)\n", TRANSACTIONS_DB_FILE);
+    printf("==========================================\n");
+
+    int fd = open_for_dump(TRANSACTIONS_DB_FILE);
+    txn_file_header_t hdr;
+    if (fd < 0 || pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || hdr.magic != TXN_FILE_MAGIC) {
+        fprintf(stderr, "transactions.db is missing or not in the compact format\n");
+        if (fd >= 0) close(fd);
+        return;
+    }
+    uint64_t rows = (uint64_t)(lseek(fd, 0, SEEK_END) / TXN_DISK_REC_SIZE) - 1;
+
+    txn_segment_t *segs;
+    int seg_count = load_segments(&segs);
+    int skipped = 0, printed = 0;
+    uint64_t open_from = 0;
+    for (int i = 0; i < seg_count; i++) {
+        open_from = segs[i].first_row + segs[i].rows;
+        if (segs[i].max_time < from || segs[i].min_time > to ||
+            (account && !txn_segment_may_hold(&segs[i], account))) {
+            skipped++;
+            continue;
+        }
+        printed += print_matching_rows(fd, hdr.base_time, segs[i].first_row, open_from, from, to, account);
+    }
+    // The open segment has no footer yet: read all of it
+    printed += print_matching_rows(fd, hdr.base_time, open_from, rows, from, to, account);
+    printf("\n  %d matching record(s); %d of %d sealed segment(s) skipped, open segment read (%llu records)\n",
+           printed, skipped, seg_count, (unsigned long long)(rows > open_from ? rows - open_from : 0));
+    free(segs);
+    close(fd);
+}
+
 void print_loans() {
     printf("\n==========================================\n");
     printf("  DUMPING LOANS (from %s)\n", LOANS_DB_FILE);
     printf("==========================================\n");
 
-    int fd = open(LOANS_DB_FILE, O_RDONLY);
+    int fd = open_for_dump(LOANS_DB_FILE);
     if (fd < 0) {
         perror("Could not open loans.db");
         return;
     }
 
     loan_rec_t loan;
+    char amt[MONEY_STR_LEN];
     int count = 1;
     while (read(fd, &loan, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
         printf("\n--- Loan Record %d ---\n", count++);
         printf("  Loan ID:      %llu\n", (unsigned long long)loan.loan_id);
         printf("  User ID:      %u\n", loan.user_id);
-        printf("  Amount:       %.2f\n", loan.amount);
+        printf("  Amount:       %s\n", money_format(loan.amount, amt, sizeof(amt)));
         printf("  Status:       %s (%d)\n", get_loan_status_str(loan.status), loan.status);
         printf("  Assigned To:  %u\n", loan.assigned_to);
         printf("  Remarks:      %s\n", loan.remarks);
@@ -155,7 +310,7 @@ void print_feedback() {
     printf("  DUMPING FEEDBACK (from %s)\n", FEEDBACK_DB_FILE);
     printf("==========================================\n");
 
-    int fd = open(FEEDBACK_DB_FILE, O_RDONLY);
+    int fd = open_for_dump(FEEDBACK_DB_FILE);
     if (fd < 0) {
         perror("Could not open feedback.db");
         return;
@@ -178,7 +333,7 @@ void print_feedback() {
 
 /* --- Main Function --- */
 
-int main() {
+int main(int argc, char **argv) {
     printf("--- [Database Inspector Utility] ---\n");
 
     // Make sure the DB directory exists first
@@ -188,6 +343,20 @@ int main() {
         return EXIT_FAILURE;
     }
 
+    if (txn_archive_open(0) != 0) perror("Could not open the transaction archive");
+
+    // inspector FROM TO [ACCOUNT]: only the transactions in that range of UTC days
+    if (argc >= 3) {
+        time_t from, to;
+        if (!txn_segment_parse_day(argv[1], &from) || !txn_segment_parse_day(argv[2], &to)) {
+            fprintf(stderr, "Usage: %s [FROM_DAY TO_DAY [ACCOUNT_ID]]  (days as YYYY-MM-DD, UTC)\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        query_transactions(from, to + TXN_SEGMENT_SECONDS - 1, argc >= 4 ? (uint32_t)strtoul(argv[3], NULL, 10) : 0);
+        printf("\n--- [Inspection Complete] ---\n");
+        return EXIT_SUCCESS;
+    }
+
     print_users();
     print_accounts();
     print_transactions();
@@ -1,5 +1,6 @@
 #include "employee_module.h"
 #include "utils.h"
+#include "txn_log.h"
 #include <stdio.h>
 #include <string.h>
 #include <stddef.h>
@@ -11,7 +12,7 @@
 
 int deposit_modifier(account_rec_t *acc, void *data);   // Prototype from customer_module.c
 typedef struct {
-    double amount;
+    money_t amount;
 } txn_data_t;
 
 /* --- Modifier for approve_reject_loan (Atomic Loan Update Logic) --- */
@@ -20,10 +21,11 @@ typedef struct {
     uint32_t emp_id;
     char *resp_msg;
     size_t resp_sz;
+    txn_rows_t *log;        // LOAN_DEPOSIT row on approval
 } approve_loan_data;
 
-// Loan modification logic (Executed under loan record lock)
-int approve_reject_loan_modifier(loan_rec_t *loan, void *data) {
+// Loan modification logic (Executed under the loan and customer account record locks)
+int approve_reject_loan_modifier(loan_rec_t *loan, account_rec_t *acc, void *data) {
     approve_loan_data *d = (approve_loan_data*)data;
 
     // Consistency Checks
@@ -37,30 +39,24 @@ int approve_reject_loan_modifier(loan_rec_t *loan, void *data) {
     }
     
     if(strcmp(d->action,"approve")==0) {
-        loan->status = LOAN_APPROVED;
-        
-        /* --- CRITICAL: SEQUENTIAL ATOMIC OPERATION (Loan Approval + Deposit) --- */
-        
-        // 1. Check account status *before* trying to deposit
-        account_rec_t cust_acc;
-        if (!read_account(loan->user_id, &cust_acc) || cust_acc.active == STATUS_INACTIVE) {
+        /* --- CRITICAL: ONE ATOMIC OPERATION (Loan Approval + Deposit + Log Row) --- */
+
+        // 1. Check account status (the account is locked with the loan)
+        if (acc == NULL || acc->active == STATUS_INACTIVE) {
             snprintf(d->resp_msg, d->resp_sz, "Loan Approval Failed: Customer account is inactive or not found.");
             return 0; 
         }
         
-        // 2. Prepare the data for the *external* deposit_modifier
+        // 2. Deposit into the locked copy (written with the loan through the redo log)
         txn_data_t deposit_data = {loan->amount};
-        
-        // 3. Perform the atomic deposit
-        if (!atomic_update_account(loan->user_id, deposit_modifier, &deposit_data)) {
+        if (!deposit_modifier(acc, &deposit_data)) {
             snprintf(d->resp_msg, d->resp_sz, "Loan Decision Failed: Approved, but failed to deposit funds.");
             return 0; // Abort loan status change
         }
 
-        // 4. Log the transaction (append is atomic)
-        txn_rec_t tx = {0, 0, loan->user_id, loan->amount, time(NULL), "loan_deposit"};
-        append_transaction(&tx);
-        
+        // 3. Log the transaction (committed with the loan and the balance)
+        d->log->rows[d->log->count++] = (txn_rec_t){0, 0, loan->user_id, loan->amount, time(NULL), TXN_LOAN_DEPOSIT};
+        loan->status = LOAN_APPROVED;
     }
     else if (strcmp(d->action,"reject")==0) {
         loan->status = LOAN_REJECTED;
@@ -76,15 +72,21 @@ int approve_reject_loan_modifier(loan_rec_t *loan, void *data) {
 }
 
 
-// approve_reject_loan (Wrapper for atomic loan update)
+// approve_reject_loan (Wrapper for the atomic loan + account update)
 int approve_reject_loan(uint64_t loan_id, const char *action, uint32_t emp_id, char *resp_msg, size_t resp_sz) {
-    approve_loan_data data = {action, emp_id, resp_msg, resp_sz};
+    txn_rec_t row;
+    txn_rows_t log = {&row, 0};
+    approve_loan_data data = {action, emp_id, resp_msg, resp_sz, &log};
     
-    if (atomic_update_loan(loan_id, approve_reject_loan_modifier, &data)) {
+    resp_msg[0] = '\0';
+    if (atomic_update_loan_account(loan_id, approve_reject_loan_modifier, &data, &log)) {
         return 1; 
     }
     if (resp_msg[0] == '\0') {
          snprintf(resp_msg, resp_sz, "Loan Decision Failed (Loan not found or concurrency error)");
+    } else if (strncmp(resp_msg, "Loan ID", 7) == 0) {
+         // The decision was made but could not be made durable: nothing was changed
+         snprintf(resp_msg, resp_sz, "Loan Decision Failed: Could not record the decision");
     }
     return 0;
 }
@@ -109,7 +111,7 @@ int modify_customer_modifier(user_rec_t *user, void *data) {
          return 0; 
     }
     
-    // Concurrency Check: Ensure uniqueness (Uses full-file lock internally)
+    // Concurrency Check: Ensure uniqueness (Reserves new email/phone in the unique indexes)
     if (!check_uniqueness(user->username, d->email, d->phone, user->user_id, d->resp_msg, d->resp_sz)) {
         return 0; 
     }
@@ -139,8 +141,9 @@ int modify_customer(uint32_t user_id, const char *first_name, const char *last_n
 
 // add_new_customer (Atomic creation of user and account)
 int add_new_customer(user_rec_t *user, account_rec_t *acc, const char *username, const char *password, char *resp_msg, size_t resp_sz) {
-    if (!check_uniqueness(username, user->email, user->phone, 0, resp_msg, resp_sz)) {
-        return 0;   
+    int64_t ticket = new_user_ticket();
+    if (!check_uniqueness(username, user->email, user->phone, ticket, resp_msg, resp_sz)) {
+        return 0;   // Nothing reserved on failure
     }
     user->user_id = generate_new_userId();
     user->role = ROLE_CUSTOMER;
@@ -154,8 +157,11 @@ int add_new_customer(user_rec_t *user, account_rec_t *acc, const char *username,
     acc->account_id = user->user_id; 
     acc->balance = 0;
     acc->active = STATUS_ACTIVE;
+    acc->redo_seq = 0;
     
-    if (write_user(user) && write_account(acc)) {
+    if (!write_user(user)) {
+        release_user_keys(username, user->email, user->phone, ticket);  // Free our reservation
+    } else if (write_account(acc)) {
         snprintf(resp_msg, resp_sz, "Customer Added (ID: %u, Username: %s)", user->user_id, user->username);
         return 1;
     }
@@ -164,31 +170,50 @@ int add_new_customer(user_rec_t *user, account_rec_t *acc, const char *username,
     return 0;
 }
 
-// view_assigned_loans (Read-only list)
-int view_assigned_loans(uint32_t emp_id, char *resp_msg, size_t resp_sz) {
-    int fd = open(LOANS_DB_FILE, O_RDONLY);
-    if(fd<0) { snprintf(resp_msg,resp_sz,"No loans file found"); return 0; }
-    lock_file(fd);
-    
-    loan_rec_t loan;
+/* --- Visitors for the loan queues (indexed, in loan id order) --- */
+typedef struct {
+    char *resp_msg;
+    size_t resp_sz;
+    int found;
+} loan_queue_data;
+
+int assigned_loan_visitor(const loan_rec_t *loan, void *data) {
+    loan_queue_data *d = (loan_queue_data*)data;
+    const char *status_map[] = {"PENDING", "ASSIGNED", "APPROVED", "REJECTED"};
     char tmp[256]; 
+    if(loan->status == LOAN_ASSIGNED) {     // Decided loans stay on the assignee's list
+        char amt[MONEY_STR_LEN];
+        snprintf(tmp,sizeof(tmp),"%-4llu | %-7u | %-8s | %s\n",
+                 (unsigned long long)loan->loan_id, loan->user_id, money_format(loan->amount, amt, sizeof(amt)), status_map[loan->status]);
+        strncat(d->resp_msg,tmp,d->resp_sz-strlen(d->resp_msg)-1);
+        d->found = 1;
+    }
+    return 1;
+}
+
+int pending_loan_visitor(const loan_rec_t *loan, void *data) {
+    loan_queue_data *d = (loan_queue_data*)data;
+    char tmp[256]; 
+    char amt[MONEY_STR_LEN];
+    snprintf(tmp,sizeof(tmp),"%-4llu | %-7u | %s\n",
+             (unsigned long long)loan->loan_id, loan->user_id, money_format(loan->amount, amt, sizeof(amt)));
+    strncat(d->resp_msg,tmp,d->resp_sz-strlen(d->resp_msg)-1);
+    d->found = 1;
+    return 1;
+}
+
+// view_assigned_loans (Read-only list via the assignee index)
+int view_assigned_loans(uint32_t emp_id, char *resp_msg, size_t resp_sz) {
     resp_msg[0]='\0';
-    int found = 0;
-    
     strncat(resp_msg, "ID   | User ID | Amount   | Status\n", resp_sz - 1);
     strncat(resp_msg, "---- | ------- | -------- | --------\n", resp_sz - 1);
-    const char *status_map[] = {"PENDING", "ASSIGNED", "APPROVED", "REJECTED"};
 
-    while(read(fd,&loan,sizeof(loan_rec_t))==sizeof(loan_rec_t)) {
-        if(loan.assigned_to == emp_id && loan.status == LOAN_ASSIGNED) {
-            snprintf(tmp,sizeof(tmp),"%-4llu | %-7u | %-8.2f | %s\n",
-                     (unsigned long long)loan.loan_id, loan.user_id, loan.amount, status_map[loan.status]);
-            strncat(resp_msg,tmp,resp_sz-strlen(resp_msg)-1);
-            found = 1;
-        }
+    loan_queue_data data = {resp_msg, resp_sz, 0};
+    if (for_each_loan(LOAN_BY_ASSIGNEE, emp_id, assigned_loan_visitor, &data) < 0) {
+        snprintf(resp_msg,resp_sz,"No loans file found");
+        return 0;
     }
-    unlock_file(fd); 
-    close(fd);
+    int found = data.found;
     
     if (!found) {
         snprintf(resp_msg, resp_sz, "No loan applications currently assigned to you.");
@@ -196,31 +221,19 @@ int view_assigned_loans(uint32_t emp_id, char *resp_msg, size_t resp_sz) {
     return 1;
 }
 
-// process_loans (View unassigned loans - Read-only list)
+// process_loans (View unassigned loans - Read-only list via the status index)
 int process_loans(char *resp_msg, size_t resp_sz) {
-    int fd = open(LOANS_DB_FILE, O_RDONLY);
-    if(fd<0) { snprintf(resp_msg,resp_sz,"No loans file found"); return 0; }
-    lock_file(fd);
-    
-    loan_rec_t loan;
-    char tmp[256]; 
     resp_msg[0]='\0';
-    int found = 0;
-    
     strncat(resp_msg, "--- Pending Loan Applications (Unassigned) ---\n", resp_sz - 1);
     strncat(resp_msg, "ID   | User ID | Amount\n", resp_sz - 1);
     strncat(resp_msg, "---- | ------- | --------\n", resp_sz - 1);
 
-    while(read(fd,&loan,sizeof(loan_rec_t))==sizeof(loan_rec_t)) {
-        if(loan.status == LOAN_PENDING) {
-            snprintf(tmp,sizeof(tmp),"%-4llu | %-7u | %.2f\n",
-                     (unsigned long long)loan.loan_id, loan.user_id, loan.amount);
-            strncat(resp_msg,tmp,resp_sz-strlen(resp_msg)-1);
-            found = 1;
-        }
+    loan_queue_data data = {resp_msg, resp_sz, 0};
+    if (for_each_loan(LOAN_BY_STATUS, LOAN_PENDING, pending_loan_visitor, &data) < 0) {
+        snprintf(resp_msg,resp_sz,"No loans file found");
+        return 0;
     }
-    unlock_file(fd); 
-    close(fd);
+    int found = data.found;
     
     if (!found) {
         snprintf(resp_msg, resp_sz, "No pending loan applications available to process.");
@@ -228,7 +241,60 @@ int process_loans(char *resp_msg, size_t resp_sz) {
     return 1;
 }
 
-// view_customer_transactions (Auditing tool - Read-only list, reads backward)
+/* --- Visitor for view_customer_transactions (rows arrive newest first) --- */
+typedef struct {
+    uint32_t custId;
+    char *resp_msg;
+    size_t resp_sz;
+    int found;
+} cust_history_data;
+
+int cust_history_visitor(const txn_rec_t *tx, void *data) {
+    cust_history_data *d = (cust_history_data*)data;
+    uint32_t custId = d->custId;
+    char tmp[256];
+
+    char time_str[64];
+    struct tm *tm_info = localtime(&tx->timestamp);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
+    
+    char type_str[16];
+    uint32_t other_id = 0;
+    int tx_is_relevant = 0;
+
+    if (tx->type == TXN_DEPOSIT && tx->to_account == custId) {
+        strcpy(type_str, "DEPOSIT");
+        other_id = tx->from_account;
+        tx_is_relevant = 1;
+    } else if (tx->type == TXN_WITHDRAW && tx->from_account == custId) {
+        strcpy(type_str, "WITHDRAW");
+        other_id = tx->to_account;
+        tx_is_relevant = 1;
+    } else if (tx->type == TXN_TRANSFER_OUT && tx->from_account == custId) {
+        strcpy(type_str, "TRANSFER_OUT");
+        other_id = tx->to_account;
+        tx_is_relevant = 1;
+    } else if (tx->type == TXN_TRANSFER_IN && tx->to_account == custId) {
+        strcpy(type_str, "TRANSFER_IN");
+        other_id = tx->from_account;
+        tx_is_relevant = 1;
+    } else if (tx->type == TXN_LOAN_DEPOSIT && tx->to_account == custId) {
+        strcpy(type_str, "LOAN_DEPOSIT");
+        other_id = 0; 
+        tx_is_relevant = 1;
+    }
+
+    if(tx_is_relevant) {
+        d->found = 1;
+        char amt[MONEY_STR_LEN];
+        snprintf(tmp, sizeof(tmp), "%-11s | %-8s | %-10u | %s\n",
+                 type_str, money_format(tx->amount, amt, sizeof(amt)), other_id, time_str);
+        strncat(d->resp_msg, tmp, d->resp_sz - strlen(d->resp_msg) - 1);
+    }
+    return strlen(d->resp_msg) + 1 < d->resp_sz; // Stop once the response is full
+}
+
+// view_customer_transactions (Auditing tool - Read-only list, follows the posting chain newest first)
 int view_customer_transactions(uint32_t custId, char *resp_msg, size_t resp_sz) {
     
     user_rec_t user;
@@ -237,68 +303,47 @@ int view_customer_transactions(uint32_t custId, char *resp_msg, size_t resp_sz)
         return 0;
     }
 
-    int fd = open(TRANSACTIONS_DB_FILE, O_RDONLY);
-    if(fd<0) { snprintf(resp_msg,resp_sz,"No transaction history found for customer %u", custId); return 0; }
-    
-    lock_file(fd);
-    txn_rec_t tx;
-    char tmp[256]; 
-    resp_msg[0] = '\0';
-    int found = 0;
-    
     snprintf(resp_msg, resp_sz, "--- Transaction History for Customer %u ---\n", custId);
     strncat(resp_msg, "Type        | Amount   | Other Acct | Timestamp\n", resp_sz - strlen(resp_msg) - 1);
     strncat(resp_msg, "------------|----------|------------|-------------------\n", resp_sz - strlen(resp_msg) - 1);
 
-    off_t offset = lseek(fd, -sizeof(txn_rec_t), SEEK_END);
-    while(offset >= 0) {
-        if(read(fd, &tx, sizeof(txn_rec_t)) != sizeof(txn_rec_t)) break;
-        
-       char time_str[64];
-        struct tm *tm_info = localtime(&tx.timestamp);
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-        
-        char type_str[16];
-        uint32_t other_id = 0;
-        int tx_is_relevant = 0;
-
-        if (strcmp(tx.narration, "deposit") == 0 && tx.to_account == custId) {
-            strcpy(type_str, "DEPOSIT");
-            other_id = tx.from_account;
-            tx_is_relevant = 1;
-        } else if (strcmp(tx.narration, "withdraw") == 0 && tx.from_account == custId) {
-            strcpy(type_str, "WITHDRAW");
-            other_id = tx.to_account;
-            tx_is_relevant = 1;
-        } else if (strcmp(tx.narration, "transfer_out") == 0 && tx.from_account == custId) {
-            strcpy(type_str, "TRANSFER_OUT");
-            other_id = tx.to_account;
-            tx_is_relevant = 1;
-        } else if (strcmp(tx.narration, "transfer_in") == 0 && tx.to_account == custId) {
-            strcpy(type_str, "TRANSFER_IN");
-            other_id = tx.from_account;
-            tx_is_relevant = 1;
-        } else if (strcmp(tx.narration, "loan_deposit") == 0 && tx.to_account == custId) {
-            strcpy(type_str, "LOAN_DEPOSIT");
-            other_id = 0; 
-            tx_is_relevant = 1;
-        }
-
-        if(tx_is_relevant) {
-            found = 1;
-            snprintf(tmp, sizeof(tmp), "%-11s | %-8.2f | %-10u | %s\n",
-                     type_str, tx.amount, other_id, time_str);
-            strncat(resp_msg, tmp, resp_sz - strlen(resp_msg) - 1);
-        }
-        
-        offset = lseek(fd, -2 * sizeof(txn_rec_t), SEEK_CUR);
+    cust_history_data data = {custId, resp_msg, resp_sz, 0};
+    if (txn_log_history(custId, cust_history_visitor, &data) < 0) {
+        snprintf(resp_msg,resp_sz,"No transaction history found for customer %u", custId);
+        return 0;
     }
-    
-    unlock_file(fd);
-    close(fd);
+    int found = data.found;
     
     if (!found) { 
         snprintf(resp_msg, resp_sz, "No transaction history found for customer %u.", custId);
     }
     return 1;
+}
+
+// view_customer_transactions_range (Same list for [from, to]; the log skips segments by their footers)
+int view_customer_transactions_range(uint32_t custId, time_t from, time_t to, char *resp_msg, size_t resp_sz) {
+
+    user_rec_t user;
+    if (!read_user(custId, &user) || user.role != ROLE_CUSTOMER) {
+        snprintf(resp_msg, resp_sz, "Customer ID %u not found.", custId);
+        return 0;
+    }
+
+    char from_str[16], to_str[16];
+    struct tm day;
+    strftime(from_str, sizeof(from_str), "%Y-%m-%d", gmtime_r(&from, &day));
+    strftime(to_str, sizeof(to_str), "%Y-%m-%d", gmtime_r(&to, &day));
+    snprintf(resp_msg, resp_sz, "--- Transaction History for Customer %u (%s to %s, UTC) ---\n", custId, from_str, to_str);
+    strncat(resp_msg, "Type        | Amount   | Other Acct | Timestamp\n", resp_sz - strlen(resp_msg) - 1);
+    strncat(resp_msg, "------------|----------|------------|-------------------\n", resp_sz - strlen(resp_msg) - 1);
+
+    cust_history_data data = {custId, resp_msg, resp_sz, 0};
+    if (txn_log_range(custId, from, to, cust_history_visitor, &data) < 0) {
+        snprintf(resp_msg, resp_sz, "Could not read the transaction history of customer %u", custId);
+        return 0;
+    }
+    if (!data.found) {
+        snprintf(resp_msg, resp_sz, "No transactions found for customer %u between %s and %s.", custId, from_str, to_str);
+    }
+    return 1;
 }
\ No newline at end of file
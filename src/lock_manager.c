@@ -0,0 +1,169 @@
+#include "lock_manager.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+/*
+ * --- LOCK MANAGER MODULE (Spin-then-park multi-mode locks) ---
+ * Every lock is one atomic word holding a holder count per mode, so an uncontended
+ * acquire/release is a single compare-and-swap with no system call. A waiter spins
+ * briefly, then parks on the lock's condition variable until a release wakes it.
+ *
+ * Tables are locked hierarchically: a record lock first takes its table in an
+ * intention mode (IS/IX), so whole-table S/X locks exclude record writers/readers
+ * without touching every stripe.
+ */
+
+#define LM_SPIN_LIMIT 128
+
+// Internal modes: table intentions plus the public shared/exclusive modes
+typedef enum { LM_IS = 0, LM_IX, LM_S, LM_X } lm_mode_t;
+
+#define LM_FIELD(m) (0xFFFFULL << (16 * (m)))   // 16-bit holder count per mode
+
+static const uint64_t lm_unit[4] = { 1ULL << 0, 1ULL << 16, 1ULL << 32, 1ULL << 48 };
+
+// Holder counts that block a new holder of each mode
+static const uint64_t lm_conflicts[4] = {
+    [LM_IS] = LM_FIELD(LM_X),
+    [LM_IX] = LM_FIELD(LM_S) | LM_FIELD(LM_X),
+    [LM_S]  = LM_FIELD(LM_IX) | LM_FIELD(LM_X),
+    [LM_X]  = LM_FIELD(LM_IS) | LM_FIELD(LM_IX) | LM_FIELD(LM_S) | LM_FIELD(LM_X),
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define lm_cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define lm_cpu_relax() __asm__ __volatile__("yield")
+#else
+#define lm_cpu_relax() ((void)0)
+#endif
+
+typedef struct {
+    _Atomic uint64_t state;
+    _Atomic uint32_t parked;    // Waiters sleeping on park_cond
+    pthread_mutex_t park_lock;
+    pthread_cond_t park_cond;
+} lm_lock_t;
+
+typedef struct {
+    lm_lock_t table;
+    lm_lock_t stripes[LOCK_MANAGER_STRIPES];
+} lm_table_t;
+
+static lm_table_t lm_tables[LOCK_MANAGER_TABLES];
+static pthread_once_t lm_once = PTHREAD_ONCE_INIT;
+
+static void lm_lock_init(lm_lock_t *l) {
+    atomic_init(&l->state, 0);
+    atomic_init(&l->parked, 0);
+    pthread_mutex_init(&l->park_lock, NULL);
+    pthread_cond_init(&l->park_cond, NULL);
+}
+
+static void lm_init(void) {
+    for (int t = 0; t < LOCK_MANAGER_TABLES; t++) {
+        lm_lock_init(&lm_tables[t].table);
+        for (int i = 0; i < LOCK_MANAGER_STRIPES; i++) {
+            lm_lock_init(&lm_tables[t].stripes[i]);
+        }
+    }
+}
+
+static int lm_try_acquire(lm_lock_t *l, lm_mode_t mode) {
+    uint64_t s = atomic_load_explicit(&l->state, memory_order_relaxed);
+    while ((s & lm_conflicts[mode]) == 0) {
+        if (atomic_compare_exchange_weak_explicit(&l->state, &s, s + lm_unit[mode],
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void lm_acquire(lm_lock_t *l, lm_mode_t mode) {
+    for (int spin = 0; spin < LM_SPIN_LIMIT; spin++) {
+        if (lm_try_acquire(l, mode)) return;
+        lm_cpu_relax();
+    }
+    // Park: 'parked' is raised before the final re-check, so a release either is
+    // seen by that re-check or sees the waiter and broadcasts under park_lock.
+    atomic_fetch_add(&l->parked, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    pthread_mutex_lock(&l->park_lock);
+    while (!lm_try_acquire(l, mode)) {
+        pthread_cond_wait(&l->park_cond, &l->park_lock);
+    }
+    pthread_mutex_unlock(&l->park_lock);
+    atomic_fetch_sub(&l->parked, 1);
+}
+
+static void lm_release(lm_lock_t *l, lm_mode_t mode) {
+    atomic_fetch_sub_explicit(&l->state, lm_unit[mode], memory_order_seq_cst);
+    if (atomic_load(&l->parked) != 0) {
+        pthread_mutex_lock(&l->park_lock);
+        pthread_cond_broadcast(&l->park_cond);
+        pthread_mutex_unlock(&l->park_lock);
+    }
+}
+
+// Fibonacci hashing so dense ids spread over the stripes
+static lm_lock_t *lm_stripe(unsigned table, uint64_t record_id) {
+    return &lm_tables[table].stripes[((record_id * 0x9E3779B97F4A7C15ULL) >> 32) % LOCK_MANAGER_STRIPES];
+}
+
+void lm_lock_table(unsigned table, lock_mode_t mode) {
+    pthread_once(&lm_once, lm_init);
+    lm_acquire(&lm_tables[table].table, mode == LOCK_EXCLUSIVE ? LM_X : LM_S);
+}
+
+void lm_unlock_table(unsigned table, lock_mode_t mode) {
+    lm_release(&lm_tables[table].table, mode == LOCK_EXCLUSIVE ? LM_X : LM_S);
+}
+
+void lm_lock_record(unsigned table, uint64_t record_id, lock_mode_t mode) {
+    pthread_once(&lm_once, lm_init);
+    lm_acquire(&lm_tables[table].table, mode == LOCK_EXCLUSIVE ? LM_IX : LM_IS);
+    lm_acquire(lm_stripe(table, record_id), mode == LOCK_EXCLUSIVE ? LM_X : LM_S);
+}
+
+void lm_unlock_record(unsigned table, uint64_t record_id, lock_mode_t mode) {
+    lm_release(lm_stripe(table, record_id), mode == LOCK_EXCLUSIVE ? LM_X : LM_S);
+    lm_release(&lm_tables[table].table, mode == LOCK_EXCLUSIVE ? LM_IX : LM_IS);
+}
+
+// Distinct stripes of 'ids' in address order (insertion sort: sets are small)
+static int lm_stripe_set(unsigned table, const uint64_t *ids, int count, lm_lock_t **out) {
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        lm_lock_t *l = lm_stripe(table, ids[i]);
+        int pos = n;
+        while (pos > 0 && out[pos - 1] > l) pos--;
+        if (pos > 0 && out[pos - 1] == l) continue;
+        memmove(&out[pos + 1], &out[pos], (n - pos) * sizeof(*out));
+        out[pos] = l;
+        n++;
+    }
+    return n;
+}
+
+// Stripes are always taken lowest address first, so two set lockers can never wait on
+// each other in a cycle whatever order their ids are passed in
+void lm_lock_record_set(unsigned table, const uint64_t *record_ids, int count, lock_mode_t mode) {
+    pthread_once(&lm_once, lm_init);
+    lm_lock_t *stripes[count];
+    int n = lm_stripe_set(table, record_ids, count, stripes);
+    lm_acquire(&lm_tables[table].table, mode == LOCK_EXCLUSIVE ? LM_IX : LM_IS);
+    for (int i = 0; i < n; i++) {
+        lm_acquire(stripes[i], mode == LOCK_EXCLUSIVE ? LM_X : LM_S);
+    }
+}
+
+void lm_unlock_record_set(unsigned table, const uint64_t *record_ids, int count, lock_mode_t mode) {
+    lm_lock_t *stripes[count];
+    int n = lm_stripe_set(table, record_ids, count, stripes);
+    for (int i = n - 1; i >= 0; i--) {
+        lm_release(stripes[i], mode == LOCK_EXCLUSIVE ? LM_X : LM_S);
+    }
+    lm_release(&lm_tables[table].table, mode == LOCK_EXCLUSIVE ? LM_IX : LM_IS);
+}
@@ -72,31 +72,32 @@ int assign_loan_to_employee(uint32_t loanId, uint32_t empId, char *resp_msg, siz
     return 0;
 }
 
-// view_non_assigned_loans (Read-only list)
-int view_non_assigned_loans(char *resp_msg, size_t resp_sz) {
-    int fd = open(LOANS_DB_FILE,O_RDONLY);
-    if(fd<0) { snprintf(resp_msg,resp_sz,"No loans file found"); return 0; }
-    
-    lock_file(fd);
-    loan_rec_t loan;
+/* --- Visitor for view_non_assigned_loans (status index, in loan id order) --- */
+typedef struct {
+    char *resp_msg;
+    size_t resp_sz;
+} pending_list_data;
+
+int non_assigned_loan_visitor(const loan_rec_t *loan, void *data) {
+    pending_list_data *d = (pending_list_data*)data;
     char tmp[256]; 
-    resp_msg[0]='\0';
-    int found = 0;
+    char amt[MONEY_STR_LEN];
+    snprintf(tmp,sizeof(tmp),"%-4llu | %-7u | %s\n",
+             (unsigned long long)loan->loan_id, loan->user_id, money_format(loan->amount, amt, sizeof(amt)));
+    strncat(d->resp_msg,tmp,d->resp_sz-strlen(d->resp_msg)-1);
+    return 1;
+}
 
+// view_non_assigned_loans (Read-only list via the status index)
+int view_non_assigned_loans(char *resp_msg, size_t resp_sz) {
+    resp_msg[0]='\0';
     strncat(resp_msg, "--- Non-Assigned (Pending) Loans ---\n", resp_sz - 1);
     strncat(resp_msg, "ID   | User ID | Amount\n", resp_sz - 1);
     strncat(resp_msg, "---- | ------- | --------\n", resp_sz - 1);
 
-    while(read(fd,&loan,sizeof(loan_rec_t))==sizeof(loan_rec_t)) {
-        if(loan.status == LOAN_PENDING) {
-            snprintf(tmp,sizeof(tmp),"%-4llu | %-7u | %.2f\n",
-                     (unsigned long long)loan.loan_id, loan.user_id, loan.amount);
-            strncat(resp_msg,tmp,resp_sz-strlen(resp_msg)-1);
-            found = 1;
-        }
-    }
-    unlock_file(fd); 
-    close(fd);
+    pending_list_data data = {resp_msg, resp_sz};
+    int found = for_each_loan(LOAN_BY_STATUS, LOAN_PENDING, non_assigned_loan_visitor, &data);
+    if (found < 0) { snprintf(resp_msg,resp_sz,"No loans file found"); return 0; }
     
     if(!found) {
         snprintf(resp_msg, resp_sz, "No non-assigned loans found.");
@@ -104,39 +105,28 @@ int view_non_assigned_loans(char *resp_msg, size_t resp_sz) {
     return 1;
 }
 
-// review_feedbacks (CRITICAL: Batch Update, uses full-file lock)
+/* --- Visitor for review_feedbacks (pending feedback queue, oldest first) --- */
+typedef struct {
+    char *resp_msg;
+    size_t resp_sz;
+} review_list_data;
+
+void review_feedback_visitor(const feedback_rec_t *fb, void *data) {
+    review_list_data *d = (review_list_data*)data;
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "ID: %llu, User: %u, Msg: \"%.100s\"\n",
+        (unsigned long long)fb->fb_id, fb->user_id, fb->message);
+    strncat(d->resp_msg, tmp, d->resp_sz - strlen(d->resp_msg) - 1);
+}
+
+// review_feedbacks (Batch Update: only feedback past the reviewed watermark is touched)
 int review_feedbacks(char *resp_msg, size_t resp_sz) {
-    int fd = open(FEEDBACK_DB_FILE,O_RDWR);
-    if(fd<0) { snprintf(resp_msg,resp_sz,"No feedback file found"); return 0; }
-    
-    lock_file(fd);
-    feedback_rec_t fb; 
-    off_t pos=0;
-    int reviewed_count = 0;
-    
     resp_msg[0] = '\0';
     strncat(resp_msg, "--- Unreviewed Feedback ---\n", resp_sz - 1);
 
-    while(read(fd,&fb,sizeof(feedback_rec_t))==sizeof(feedback_rec_t)) {
-        if(fb.reviewed == 0) {
-            
-            char tmp[600];
-            snprintf(tmp, sizeof(tmp), "ID: %llu, User: %u, Msg: \"%.100s\"\n",
-                (unsigned long long)fb.fb_id, fb.user_id, fb.message);
-            strncat(resp_msg, tmp, resp_sz - strlen(resp_msg) - 1);
-
-            fb.reviewed=1;
-            lseek(fd, pos, SEEK_SET); 
-            write(fd, &fb, sizeof(feedback_rec_t));
-            lseek(fd, pos + sizeof(feedback_rec_t), SEEK_SET); 
-            
-            reviewed_count++;
-        }
-        pos += sizeof(feedback_rec_t);
-    }
-    
-    unlock_file(fd); 
-    close(fd);
+    review_list_data data = {resp_msg, resp_sz};
+    int reviewed_count = review_pending_feedback(review_feedback_visitor, &data);
+    if (reviewed_count < 0) { snprintf(resp_msg,resp_sz,"No feedback file found"); return 0; }
     
     if (reviewed_count == 0) {
         snprintf(resp_msg,resp_sz,"No new feedback found to review.");
@@ -146,4 +136,4 @@ int review_feedbacks(char *resp_msg, size_t resp_sz) {
         strncat(resp_msg, tmp, resp_sz - strlen(resp_msg) - 1);
     }
     return 1;
-}
\ No newline at end of file
+}
@@ -0,0 +1,174 @@
+#include "record_cache.h"
+#include "db_index.h"
+#include <pthread.h>
+
+/*
+ * --- RECORD CACHE MODULE (Sharded LRU of whole records) ---
+ * Entries are split across RECORD_CACHE_SHARDS shards by key; each shard has its own
+ * lock, resident map and LRU list (most recently used first). Entries not holding a
+ * record are chained on the shard's free list through 'next'. Copies in and out happen
+ * under the shard lock, so a reader never sees half of a refreshed record.
+ */
+
+#define RC_NIL UINT32_MAX
+
+typedef struct {
+    uint64_t tag;           // 0 = free
+    uint32_t prev, next;    // LRU links (free list: next only)
+    size_t size;
+    char *data;             // RECORD_CACHE_MAX_REC bytes in rc_memory
+} rc_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    rc_entry_t *entries;
+    uint32_t head, tail;    // Most / least recently used
+    uint32_t free_head;
+    id_index_t resident;    // tag -> entry of every record held
+} rc_shard_t;
+
+static rc_shard_t rc_shards[RECORD_CACHE_SHARDS];
+static char *rc_memory = NULL;
+static int rc_ready = 0;
+static record_cache_stats_t rc_stats;
+
+#define rc_count(field) atomic_fetch_add_explicit(&rc_stats.field, 1, memory_order_relaxed)
+
+static uint64_t rc_tag(db_table_id_t table, uint64_t key) {
+    return ((uint64_t)(table + 1) << 48) | key;
+}
+
+static rc_shard_t *rc_shard_of(uint64_t tag) {
+    return &rc_shards[((tag * 0x9E3779B97F4A7C15ull) >> 32) % RECORD_CACHE_SHARDS];
+}
+
+/* --- LRU LIST (caller holds the shard lock) --- */
+
+static void rc_unlink(rc_shard_t *s, uint32_t i) {
+    rc_entry_t *e = &s->entries[i];
+    if (e->prev != RC_NIL) s->entries[e->prev].next = e->next;
+    else s->head = e->next;
+    if (e->next != RC_NIL) s->entries[e->next].prev = e->prev;
+    else s->tail = e->prev;
+}
+
+static void rc_push_front(rc_shard_t *s, uint32_t i) {
+    rc_entry_t *e = &s->entries[i];
+    e->prev = RC_NIL;
+    e->next = s->head;
+    if (s->head != RC_NIL) s->entries[s->head].prev = i;
+    else s->tail = i;
+    s->head = i;
+}
+
+// Unlink an entry holding a record and chain it on the free list
+static void rc_release(rc_shard_t *s, uint32_t i) {
+    rc_unlink(s, i);
+    id_index_del(&s->resident, s->entries[i].tag);
+    s->entries[i].tag = 0;
+    s->entries[i].next = s->free_head;
+    s->free_head = i;
+}
+
+/* --- LIFECYCLE --- */
+
+int record_cache_init(void) {
+    if (rc_ready) return 0;
+    long entries = RECORD_CACHE_ENTRIES_DEFAULT;
+    const char *env = getenv(RECORD_CACHE_ENV);
+    if (env != NULL && *env != '\0') entries = atol(env);
+    if (entries <= 0) return 0;     // Cache disabled: every read goes to the table
+
+    uint32_t per_shard = (uint32_t)(entries / RECORD_CACHE_SHARDS);
+    if (per_shard == 0) per_shard = 1;
+    rc_memory = calloc((size_t)per_shard * RECORD_CACHE_SHARDS, RECORD_CACHE_MAX_REC);
+    if (rc_memory == NULL) return -1;
+
+    char *data = rc_memory;
+    for (int i = 0; i < RECORD_CACHE_SHARDS; i++) {
+        rc_shard_t *s = &rc_shards[i];
+        pthread_mutex_init(&s->lock, NULL);
+        s->entries = calloc(per_shard, sizeof(rc_entry_t));
+        if (s->entries == NULL || !id_index_init(&s->resident, per_shard * 2)) return -1;
+        s->head = s->tail = RC_NIL;
+        for (uint32_t j = 0; j < per_shard; j++, data += RECORD_CACHE_MAX_REC) {
+            s->entries[j].data = data;
+            s->entries[j].next = (j + 1 < per_shard) ? j + 1 : RC_NIL;
+        }
+        s->free_head = 0;
+    }
+    rc_ready = 1;
+    return 0;
+}
+
+int record_cache_enabled(void) {
+    return rc_ready;
+}
+
+const record_cache_stats_t *record_cache_stats(void) {
+    return &rc_stats;
+}
+
+/* --- LOOKUP + UPDATE --- */
+
+int rc_get(db_table_id_t table, uint64_t key, size_t rec_size, void *out) {
+    if (!rc_ready) return 0;
+    uint64_t tag = rc_tag(table, key);
+    rc_shard_t *s = rc_shard_of(tag);
+    pthread_mutex_lock(&s->lock);
+    int64_t i = id_index_get(&s->resident, tag);
+    int hit = (i >= 0 && s->entries[i].size == rec_size);
+    if (hit) {
+        memcpy(out, s->entries[i].data, rec_size);
+        rc_unlink(s, (uint32_t)i);
+        rc_push_front(s, (uint32_t)i);
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (hit) rc_count(hits);
+    else rc_count(misses);
+    return hit;
+}
+
+void rc_put(db_table_id_t table, uint64_t key, size_t rec_size, const void *rec) {
+    if (!rc_ready || rec_size > RECORD_CACHE_MAX_REC) return;
+    uint64_t tag = rc_tag(table, key);
+    rc_shard_t *s = rc_shard_of(tag);
+    pthread_mutex_lock(&s->lock);
+    int64_t found = id_index_get(&s->resident, tag);
+    uint32_t i;
+    if (found >= 0) {
+        i = (uint32_t)found;
+        rc_unlink(s, i);
+    } else {
+        if (s->free_head == RC_NIL) {
+            rc_release(s, s->tail);     // Least recently used makes room
+            rc_count(evictions);
+        }
+        i = s->free_head;
+        s->free_head = s->entries[i].next;
+        if (!id_index_put(&s->resident, tag, i)) {
+            s->entries[i].next = s->free_head;
+            s->free_head = i;
+            pthread_mutex_unlock(&s->lock);
+            return;
+        }
+        s->entries[i].tag = tag;
+    }
+    memcpy(s->entries[i].data, rec, rec_size);
+    s->entries[i].size = rec_size;
+    rc_push_front(s, i);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void rc_invalidate(db_table_id_t table, uint64_t key) {
+    if (!rc_ready) return;
+    uint64_t tag = rc_tag(table, key);
+    rc_shard_t *s = rc_shard_of(tag);
+    pthread_mutex_lock(&s->lock);
+    int64_t i = id_index_get(&s->resident, tag);
+    if (i >= 0) {
+        rc_release(s, (uint32_t)i);
+        rc_count(invalidations);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
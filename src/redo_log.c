@@ -0,0 +1,391 @@
+#include "redo_log.h"
+#include "utils.h"
+#include "txn_log.h"
+#include <sys/stat.h>
+#include <pthread.h>
+
+/*
+ * --- REDO LOG MODULE (Write-ahead change sets for multi-file operations) ---
+ * Entries are appended to redo.db under one mutex and synced outside it. Every image an
+ * entry writes is stamped with its seq, and accounts.db / loans.db are only synced when
+ * redo.db starts over, so after a power loss any entry still in redo.db (APPLIED and
+ * DONE ones too) may be missing from the data files. Recovery rewrites an image only
+ * where the record's stamp is older than the entry: a record that already holds the
+ * entry, or a later change on top of it, is left as it is.
+ */
+
+#if defined(__APPLE__)
+#define redo_datasync(fd) fsync(fd)
+#else
+#define redo_datasync(fd) fdatasync(fd)
+#endif
+
+static pthread_mutex_t redo_lock = PTHREAD_MUTEX_INITIALIZER;
+static off_t redo_end = -1;             // Append offset (-1 until first use)
+static uint64_t redo_next_seq = 1;
+static int redo_inflight = 0;           // Committed entries not yet DONE or CANCELLED
+static int redo_sync = -1;              // BANK_TXN_FSYNC != "none" (-1 until first use)
+
+// APPLIED entries whose log rows could not be committed: retried by redo_checkpoint()
+typedef struct redo_pending {
+    uint64_t seq;
+    uint64_t log_rows;          // Log size before the failed commit (its rows can only be after)
+    int count;
+    struct redo_pending *next;
+    txn_rec_t rows[];
+} redo_pending_t;
+static redo_pending_t *redo_pending = NULL;
+static void redo_retry_rows(redo_pending_t *list);
+
+static size_t redo_payload_size(const redo_rec_header_t *hdr) {
+    return hdr->accounts * sizeof(account_rec_t) + hdr->loans * sizeof(loan_rec_t) + hdr->txns * sizeof(txn_rec_t);
+}
+
+static uint64_t redo_checksum(redo_rec_header_t hdr, const void *payload) {
+    hdr.checksum = 0;
+    uint64_t h = fnv1a_update(FNV1A_INIT, &hdr, sizeof(hdr));
+    return fnv1a_update(h, payload, redo_payload_size(&hdr));
+}
+
+// Append one record at the end of redo.db (caller holds redo_lock)
+static int redo_append(int fd, const void *rec, size_t len) {
+    if (redo_end < 0) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) return 0;
+        redo_end = st.st_size;
+        const char *policy = getenv(TXN_FSYNC_ENV);
+        redo_sync = !(policy != NULL && strcmp(policy, "none") == 0);
+    }
+    if (pwrite(fd, rec, len, redo_end) != (ssize_t)len) return 0;
+    redo_end += len;
+    return 1;
+}
+
+static redo_rec_header_t redo_marker(redo_rec_kind_t kind, uint64_t seq) {
+    redo_rec_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = REDO_MAGIC;
+    hdr.kind = kind;
+    hdr.seq = seq;
+    hdr.checksum = redo_checksum(hdr, NULL);
+    return hdr;
+}
+
+// Start redo.db over with a CHECKPOINT for 'last_seq' (caller holds redo_lock and has
+// synced the data files). The marker overwrites the head of the file before it is cut,
+// so a crash in between leaves the marker and a damaged record that parsing stops at.
+static int redo_start_over(int fd, uint64_t last_seq) {
+    redo_rec_header_t hdr = redo_marker(REDO_CHECKPOINT, last_seq);
+    if (pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || ftruncate(fd, sizeof(hdr)) != 0 ||
+        (redo_sync != 0 && redo_datasync(fd) != 0)) {
+        redo_end = -1;      // Re-read from the file on the next append
+        return 0;
+    }
+    redo_end = sizeof(hdr);
+    return 1;
+}
+
+// Make every image written so far durable: accounts.db (mapped) and loans.db (whose
+// redo-logged rows were already written back from the buffer pool)
+static int redo_sync_data(void) {
+    return account_map_sync() && redo_datasync(db_table_fd(DB_LOANS)) == 0;
+}
+
+/* --- COMMIT + MARKERS --- */
+
+int redo_commit(const redo_change_t *change, uint64_t *seq) {
+    int fd = db_table_fd(DB_REDO);
+    int64_t log_rows = txn_log_rows();
+    if (fd < 0 || log_rows < 0) return 0;
+
+    redo_rec_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = REDO_MAGIC;
+    hdr.kind = REDO_ENTRY;
+    hdr.log_rows = (uint64_t)log_rows;      // The rows can only land at or after this
+    hdr.accounts = (uint16_t)change->account_count;
+    hdr.loans = change->loan ? 1 : 0;
+    hdr.txns = (uint16_t)change->row_count;
+
+    size_t len = sizeof(hdr) + redo_payload_size(&hdr);
+    char *buf = malloc(len);
+    if (buf == NULL) return 0;
+    char *p = buf + sizeof(hdr);
+    memcpy(p, change->accounts, hdr.accounts * sizeof(account_rec_t));
+    p += hdr.accounts * sizeof(account_rec_t);
+    if (change->loan) memcpy(p, change->loan, sizeof(loan_rec_t));
+    p += hdr.loans * sizeof(loan_rec_t);
+    memcpy(p, change->rows, hdr.txns * sizeof(txn_rec_t));
+
+    pthread_mutex_lock(&redo_lock);
+    hdr.seq = redo_next_seq++;
+    if ((uint32_t)hdr.seq == 0) hdr.seq = redo_next_seq++;    // Stamp 0 means "no entry"
+    hdr.checksum = redo_checksum(hdr, buf + sizeof(hdr));
+    memcpy(buf, &hdr, sizeof(hdr));
+    int ok = redo_append(fd, buf, len);
+    if (ok) redo_inflight++;
+    int sync = redo_sync;
+    pthread_mutex_unlock(&redo_lock);
+    free(buf);
+
+    // Concurrent committers overlap their syncs instead of queueing behind the mutex
+    if (ok && sync && redo_datasync(fd) != 0) {
+        redo_mark(hdr.seq, REDO_CANCELLED);     // May still be on disk: recovery must skip it
+        ok = 0;
+    }
+    if (ok) *seq = hdr.seq;
+    return ok;
+}
+
+void redo_mark(uint64_t seq, redo_rec_kind_t state) {
+    int fd = db_table_fd(DB_REDO);
+    redo_rec_header_t hdr = redo_marker(state, seq);
+
+    pthread_mutex_lock(&redo_lock);
+    redo_append(fd, &hdr, sizeof(hdr));
+    if (state == REDO_DONE || state == REDO_CANCELLED) redo_inflight--;
+    int sync = (state == REDO_CANCELLED && redo_sync);
+    pthread_mutex_unlock(&redo_lock);
+
+    // A lost CANCELLED would let recovery apply an operation its client saw fail
+    if (sync && redo_datasync(fd) != 0) perror("redo log");
+}
+
+void redo_checkpoint(void) {
+    int fd = db_table_fd(DB_REDO);
+    pthread_mutex_lock(&redo_lock);
+    redo_pending_t *pending = redo_pending;
+    redo_pending = NULL;
+    pthread_mutex_unlock(&redo_lock);
+    if (pending != NULL) redo_retry_rows(pending);
+
+    pthread_mutex_lock(&redo_lock);
+    int due = (redo_inflight == 0 && redo_end > REDO_TRUNCATE_BYTES);
+    uint64_t next = redo_next_seq;
+    pthread_mutex_unlock(&redo_lock);
+    if (!due || !redo_sync_data()) return;
+
+    pthread_mutex_lock(&redo_lock);
+    // An entry committed during the sync may have images the sync missed: try again later
+    if (redo_next_seq == next && redo_inflight == 0 && redo_end > REDO_TRUNCATE_BYTES &&
+        !redo_start_over(fd, next - 1)) {
+        perror("redo log");
+    }
+    pthread_mutex_unlock(&redo_lock);
+}
+
+/* --- RECOVERY (server_init) --- */
+
+typedef struct {
+    redo_rec_header_t hdr;
+    const char *payload;
+    redo_rec_kind_t state;      // Furthest marker seen
+} redo_entry_t;
+
+typedef struct {
+    txn_rec_t *rows;
+    size_t count;
+    size_t capacity;
+} redo_rows_t;
+
+static const account_rec_t *entry_accounts(const redo_entry_t *e) {
+    return (const account_rec_t *)e->payload;
+}
+
+static const loan_rec_t *entry_loan(const redo_entry_t *e) {
+    return e->hdr.loans ? (const loan_rec_t *)(e->payload + e->hdr.accounts * sizeof(account_rec_t)) : NULL;
+}
+
+static const txn_rec_t *entry_rows(const redo_entry_t *e) {
+    return (const txn_rec_t *)(e->payload + e->hdr.accounts * sizeof(account_rec_t) + e->hdr.loans * sizeof(loan_rec_t));
+}
+
+// Only transfers and loan deposits are written through redo entries
+static void collect_redo_rows(const txn_rec_t *tx, void *data) {
+    redo_rows_t *found = data;
+    if (tx->type != TXN_TRANSFER_OUT && tx->type != TXN_TRANSFER_IN && tx->type != TXN_LOAN_DEPOSIT) return;
+    if (found->count == found->capacity) {
+        size_t capacity = found->capacity ? found->capacity * 2 : 64;
+        txn_rec_t *rows = realloc(found->rows, capacity * sizeof(txn_rec_t));
+        if (rows == NULL) return;
+        found->rows = rows;
+        found->capacity = capacity;
+    }
+    found->rows[found->count++] = *tx;
+}
+
+static int same_row(const txn_rec_t *a, const txn_rec_t *b) {
+    return a->type == b->type && a->from_account == b->from_account && a->to_account == b->to_account &&
+           a->amount == b->amount && a->timestamp == b->timestamp;
+}
+
+// Claim a committed log row equal to 'tx'; 0 if there is none left
+static int claim_row(redo_rows_t *logged, const txn_rec_t *tx) {
+    for (size_t i = 0; i < logged->count; i++) {
+        if (logged->rows[i].type != 0 && same_row(&logged->rows[i], tx)) {
+            logged->rows[i].type = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Parse redo.db up to the first torn or damaged record
+static int redo_read_entries(const char *buf, size_t size, redo_entry_t **out, size_t *count, uint64_t *max_seq) {
+    redo_entry_t *entries = NULL;
+    size_t n = 0, capacity = 0;
+    size_t off = 0;
+    while (off + sizeof(redo_rec_header_t) <= size) {
+        redo_rec_header_t hdr;
+        memcpy(&hdr, buf + off, sizeof(hdr));
+        size_t len = sizeof(hdr) + (hdr.kind == REDO_ENTRY ? redo_payload_size(&hdr) : 0);
+        if (hdr.magic != REDO_MAGIC || hdr.kind < REDO_ENTRY || hdr.kind > REDO_CHECKPOINT || off + len > size ||
+            (hdr.kind != REDO_ENTRY && (hdr.accounts || hdr.loans || hdr.txns)) ||
+            redo_checksum(hdr, buf + off + sizeof(hdr)) != hdr.checksum) {
+            break;
+        }
+        if (hdr.seq > *max_seq) *max_seq = hdr.seq;
+        if (hdr.kind == REDO_ENTRY) {
+            if (n == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                redo_entry_t *grown = realloc(entries, capacity * sizeof(redo_entry_t));
+                if (grown == NULL) { free(entries); return 0; }
+                entries = grown;
+            }
+            entries[n++] = (redo_entry_t){ hdr, buf + off + sizeof(hdr), REDO_ENTRY };
+        } else if (hdr.kind != REDO_CHECKPOINT) {
+            for (size_t i = n; i-- > 0;) {
+                if (entries[i].hdr.seq != hdr.seq) continue;
+                if (hdr.kind > entries[i].state) entries[i].state = hdr.kind;
+                break;
+            }
+        }
+        off += len;
+    }
+    *out = entries;
+    *count = n;
+    return 1;
+}
+
+int redo_recover(void) {
+    int fd = db_table_fd(DB_REDO);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) return -1;
+    char *buf = malloc(st.st_size ? st.st_size : 1);
+    if (buf == NULL || pread(fd, buf, st.st_size, 0) != st.st_size) {
+        free(buf);
+        return -1;
+    }
+
+    redo_entry_t *entries = NULL;
+    size_t count = 0;
+    uint64_t max_seq = 0;
+    if (!redo_read_entries(buf, st.st_size, &entries, &count, &max_seq)) {
+        free(buf);
+        return -1;
+    }
+
+    // The log rows every entry may have written (each is claimed by one entry at most)
+    uint64_t from_row = UINT64_MAX;
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].hdr.log_rows < from_row) from_row = entries[i].hdr.log_rows;
+    }
+    redo_rows_t logged = { NULL, 0, 0 };
+    int finished = 0, ok = 1;
+    if (count > 0 && txn_log_replay(from_row, collect_redo_rows, &logged) < 0) ok = 0;
+
+    // Finished entries claim their rows first, so a missing row is only ever re-added once
+    for (size_t i = 0; ok && i < count; i++) {
+        if (entries[i].state != REDO_DONE) continue;
+        for (int r = 0; r < entries[i].hdr.txns; r++) claim_row(&logged, &entry_rows(&entries[i])[r]);
+    }
+    int rewritten = 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        redo_entry_t *e = &entries[i];
+        if (e->state == REDO_CANCELLED) continue;
+        // In seq order: each image goes only where the record does not hold the entry yet
+        uint32_t stamp = (uint32_t)e->hdr.seq;
+        for (int a = 0; a < e->hdr.accounts; a++) {
+            account_rec_t acc = entry_accounts(e)[a], cur;
+            if (read_account(acc.account_id, &cur) && !redo_stamp_older(cur.redo_seq, stamp)) continue;
+            acc.redo_seq = stamp;
+            if (!write_account(&acc)) ok = 0;
+            rewritten++;
+        }
+        if (e->hdr.loans) {
+            loan_rec_t loan = *entry_loan(e), cur;
+            if (!read_loan(loan.loan_id, &cur) || redo_stamp_older(cur.redo_seq, stamp)) {
+                loan.redo_seq = stamp;
+                if (!write_loan(&loan)) ok = 0;
+                rewritten++;
+            }
+        }
+        if (e->state == REDO_DONE) continue;
+        txn_rec_t missing[TXN_LOG_BATCH_MAX];
+        int n = 0;
+        for (int r = 0; r < e->hdr.txns && n < TXN_LOG_BATCH_MAX; r++) {
+            if (!claim_row(&logged, &entry_rows(e)[r])) missing[n++] = entry_rows(e)[r];
+        }
+        if (n > 0 && !append_transactions(missing, n)) ok = 0;
+        finished++;
+    }
+    free(logged.rows);
+    free(entries);
+    free(buf);
+    if (!ok) return -1;
+
+    // Everything is in place: make it durable, then start redo.db over
+    if (count > 0 && !(account_balances_flush() && redo_datasync(db_table_fd(DB_LOANS)) == 0)) return -1;
+    if (finished > 0 || rewritten > 0) {
+        printf("Redo recovery: %d unfinished operation(s) completed, %d record image(s) rewritten\n",
+               finished, rewritten);
+    }
+    pthread_mutex_lock(&redo_lock);
+    int truncated = redo_start_over(fd, max_seq);
+    redo_end = -1;
+    redo_next_seq = max_seq + 1;
+    pthread_mutex_unlock(&redo_lock);
+    return truncated ? finished : -1;
+}
+
+/* --- DEFERRED LOG ROWS --- */
+
+void redo_defer_rows(uint64_t seq, const txn_rec_t *rows, int count, uint64_t log_rows) {
+    redo_pending_t *p = malloc(sizeof(redo_pending_t) + count * sizeof(txn_rec_t));
+    fprintf(stderr, "Redo entry %llu: log rows not committed; %s\n", (unsigned long long)seq,
+            p ? "retrying before the next checkpoint" : "left to recovery at the next start");
+    if (p == NULL) return;      // Stays in flight: redo.db is kept for redo_recover()
+    p->seq = seq;
+    p->log_rows = log_rows;
+    p->count = count;
+    memcpy(p->rows, rows, count * sizeof(txn_rec_t));
+    pthread_mutex_lock(&redo_lock);
+    p->next = redo_pending;
+    redo_pending = p;
+    pthread_mutex_unlock(&redo_lock);
+}
+
+// Commit the rows each deferred entry is still missing (a failed sync may have left some
+// in the log), then mark it DONE; entries that fail again go back on the list
+static void redo_retry_rows(redo_pending_t *list) {
+    while (list != NULL) {
+        redo_pending_t *p = list;
+        list = p->next;
+        redo_rows_t logged = { NULL, 0, 0 };
+        txn_rec_t missing[TXN_LOG_BATCH_MAX];
+        int n = 0, ok = (txn_log_replay(p->log_rows, collect_redo_rows, &logged) >= 0);
+        for (int r = 0; ok && r < p->count && n < TXN_LOG_BATCH_MAX; r++) {
+            if (!claim_row(&logged, &p->rows[r])) missing[n++] = p->rows[r];
+        }
+        free(logged.rows);
+        if (ok && (n == 0 || append_transactions(missing, n))) {
+            redo_mark(p->seq, REDO_DONE);
+            free(p);
+            continue;
+        }
+        pthread_mutex_lock(&redo_lock);
+        p->next = redo_pending;
+        redo_pending = p;
+        pthread_mutex_unlock(&redo_lock);
+    }
+}
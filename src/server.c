@@ -4,6 +4,12 @@
 #include "manager_module.h"
 #include "admin_module.h"
 #include "utils.h"
+#include "txn_log.h"
+#include "txn_archive.h"
+#include "buffer_pool.h"
+#include "record_cache.h"
+#include "balance_log.h"
+#include "redo_log.h"
 
 #include <pthread.h>
 #include <sys/stat.h>
@@ -34,6 +40,32 @@ int ensure_db_dir_exists(void) {
     return 0;
 }
 
+/*
+ * lock_db_dir
+ * Takes an exclusive lock on DB_LOCK_FILE for the life of the process, so a second
+ * server cannot migrate, recover or truncate the db files under a running one.
+ */
+int lock_db_dir(void) {
+    static int lock_fd = -1;
+    if (lock_fd >= 0) return 0;
+    int fd = open(DB_LOCK_FILE, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        perror("Failed to open the db lock file");
+        return -1;
+    }
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0 };
+    if (fcntl(fd, F_SETLK, &lock) == -1) {
+        if (errno == EACCES || errno == EAGAIN)
+            fprintf(stderr, "Another server is already running on %s\n", DB_DIR);
+        else
+            perror("Failed to lock the db directory");
+        close(fd);
+        return -1;
+    }
+    lock_fd = fd;   // Held until exit
+    return 0;
+}
+
 /*
  * send_response
  * Helper function to write a response_t struct to a socket.
@@ -157,31 +189,70 @@ void *client_thread_main(void *arg) {
         }
         else if(strcmp(op,"DEPOSIT")==0) {
             uint32_t userId; 
-            double amount;
-            sscanf(payload,"%u %lf",&userId, &amount);
-            deposit_money(userId, amount, resp.message, sizeof(resp.message));
+            money_t amount;
+            char amount_str[MONEY_STR_LEN];
+            if(sscanf(payload,"%u %31s",&userId, amount_str) == 2 && money_parse(amount_str, &amount)) {
+                if (!deposit_money(userId, amount, resp.message, sizeof(resp.message))) resp.status_code = 1;
+            } else {
+                snprintf(resp.message,sizeof(resp.message),"DEPOSIT: Invalid amount (at most two decimals).");
+                resp.status_code = 1;
+            }
         }
         else if(strcmp(op,"WITHDRAW")==0) {
             uint32_t userId; 
-            double amount;
-            sscanf(payload,"%u %lf",&userId,&amount);
-            withdraw_money(userId, amount, resp.message, sizeof(resp.message));
+            money_t amount;
+            char amount_str[MONEY_STR_LEN];
+            if(sscanf(payload,"%u %31s",&userId, amount_str) == 2 && money_parse(amount_str, &amount)) {
+                if (!withdraw_money(userId, amount, resp.message, sizeof(resp.message))) resp.status_code = 1;
+            } else {
+                snprintf(resp.message,sizeof(resp.message),"WITHDRAW: Invalid amount (at most two decimals).");
+                resp.status_code = 1;
+            }
         }
         else if(strcmp(op,"TRANSFER")==0) { 
             uint32_t fromId, toId; 
-            double amount;
-            if(sscanf(payload,"%u %u %lf",&fromId,&toId,&amount) == 3) {
+            money_t amount;
+            char amount_str[MONEY_STR_LEN];
+            if(sscanf(payload,"%u %u %31s",&fromId,&toId,amount_str) == 3 && money_parse(amount_str, &amount)) {
                 transfer_funds(fromId,toId,amount,resp.message,sizeof(resp.message));
             } else {
                 snprintf(resp.message,sizeof(resp.message),"TRANSFER: Invalid payload format.");
                 resp.status_code = 1;
             }
         }
+        else if(strcmp(op,"BATCH_TRANSFER")==0) {
+            // Payload: <from_id> <to_id>:<amount> <to_id>:<amount> ...
+            uint32_t fromId;
+            batch_transfer_item_t items[MAX_BATCH_TRANSFER_ITEMS];
+            int count = 0, used = 0, rc = 0;
+            int valid = (sscanf(payload,"%u%n",&fromId,&used) == 1);
+            char *next = payload + used;
+            while (valid) {
+                uint32_t toId;
+                char amount_str[MONEY_STR_LEN];
+                rc = sscanf(next," %u:%31s%n",&toId,amount_str,&used);
+                if (rc == EOF) break;
+                valid = (rc == 2 && count < MAX_BATCH_TRANSFER_ITEMS && money_parse(amount_str, &items[count].amount));
+                if (valid) items[count++].to_id = toId;
+                next += used;
+            }
+            if (valid && count > 0) {
+                batch_transfer(fromId,items,count,resp.message,sizeof(resp.message));
+            } else {
+                snprintf(resp.message,sizeof(resp.message),"BATCH_TRANSFER: Invalid payload format (up to %d to_id:amount pairs).", MAX_BATCH_TRANSFER_ITEMS);
+                resp.status_code = 1;
+            }
+        }
         else if(strcmp(op,"APPLY_LOAN")==0) {
             uint32_t userId; 
-            double amount;
-            sscanf(payload,"%u %lf",&userId, &amount);
-            apply_loan(userId, amount, resp.message, sizeof(resp.message));
+            money_t amount;
+            char amount_str[MONEY_STR_LEN];
+            if(sscanf(payload,"%u %31s",&userId, amount_str) == 2 && money_parse(amount_str, &amount)) {
+                apply_loan(userId, amount, resp.message, sizeof(resp.message));
+            } else {
+                snprintf(resp.message,sizeof(resp.message),"APPLY_LOAN: Invalid amount (at most two decimals).");
+                resp.status_code = 1;
+            }
         }
         else if(strcmp(op,"VIEW_LOAN")==0) { 
             uint32_t userId;
@@ -268,9 +339,19 @@ void *client_thread_main(void *arg) {
             view_assigned_loans(empId,resp.message,sizeof(resp.message));
         }
         else if(strcmp(op,"VIEW_CUST_TRANSACTIONS")==0) { 
-            uint32_t custId;
-            sscanf(payload,"%u",&custId);
-            view_customer_transactions(custId,resp.message,sizeof(resp.message));
+            uint32_t custId; char from_day[16], to_day[16]; time_t from, to;
+            int fields = sscanf(payload,"%u %15s %15s",&custId,from_day,to_day);
+            if (fields == 3) {
+                // Optional FROM_DAY TO_DAY (UTC, inclusive)
+                if (txn_segment_parse_day(from_day,&from) && txn_segment_parse_day(to_day,&to) && from <= to) {
+                    view_customer_transactions_range(custId,from,to + TXN_SEGMENT_SECONDS - 1,resp.message,sizeof(resp.message));
+                } else {
+                    snprintf(resp.message,sizeof(resp.message),"VIEW_CUST_TRANSACTIONS: Invalid date range (YYYY-MM-DD YYYY-MM-DD).");
+                    resp.status_code = 1;
+                }
+            } else {
+                view_customer_transactions(custId,resp.message,sizeof(resp.message));
+            }
         }
 
         // --- SECTION: Manager Module Routes ---
@@ -345,12 +426,54 @@ void *client_thread_main(void *arg) {
 
 /*
  * server_init
- * Initializes the server context, creates the listen socket,
- * and initializes the session tracker and mutex.
+ * Initializes the server context, locks the db directory, migrates/indexes the db files,
+ * creates the listen socket, and initializes the session tracker and mutex.
  */
 int server_init(server_ctx_t *ctx, int port) {
     if(ensure_db_dir_exists() != 0) 
         return -1;
+    if(lock_db_dir() != 0)
+        return -1;
+    if(migrate_db_files() != 0) {
+        fprintf(stderr, "Failed to migrate database files\n");
+        return -1;
+    }
+    if(init_db_tables() != 0) {
+        fprintf(stderr, "Failed to open database files\n");
+        return -1;
+    }
+    if(init_txn_log() != 0) {
+        fprintf(stderr, "Failed to start the transaction log writer\n");
+        return -1;
+    }
+    if(init_db_indexes() != 0) {
+        fprintf(stderr, "Failed to build database indexes\n");
+        return -1;
+    }
+    if(init_account_map() != 0) {
+        fprintf(stderr, "Failed to map %s\n", ACCOUNTS_DB_FILE);
+        return -1;
+    }
+    if(redo_recover() < 0) {    // Straight to the files: the buffer pool starts after it
+        fprintf(stderr, "Failed to recover unfinished operations from the redo log\n");
+        return -1;
+    }
+    if(buffer_pool_init() != 0) {
+        fprintf(stderr, "Failed to allocate the buffer pool\n");
+        return -1;
+    }
+    if(record_cache_init() != 0) {
+        fprintf(stderr, "Failed to allocate the record cache\n");
+        return -1;
+    }
+    if(balance_log_init() != 0) {
+        fprintf(stderr, "Failed to load account balances from the transaction log\n");
+        return -1;
+    }
+    if(txn_archiver_start() != 0) {
+        fprintf(stderr, "Failed to start the transaction archiver\n");
+        return -1;
+    }
     ctx->port = port;
     ctx->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
     if(ctx->listen_fd<0) { 
@@ -457,6 +580,54 @@ int main(int argc, char *argv[]) {
 
     printf("Server setup complete. Starting accept loop...\n");
     server_start(&g_server_ctx);
+
+    const username_filter_stats_t *uf = username_filter_stats();
+    uint64_t unknown = uf->rejected + uf->false_positives;
+    printf("Username filter: %llu lookups, %llu unknown names rejected, %llu false positives (%.2f%% observed, %.4f%% expected)\n",
+           (unsigned long long)uf->lookups, (unsigned long long)uf->rejected, (unsigned long long)uf->false_positives,
+           unknown ? 100.0 * uf->false_positives / unknown : 0.0, 100.0 * username_filter_expected_rate());
+    if (record_cache_enabled()) {
+        const record_cache_stats_t *rc = record_cache_stats();
+        uint64_t reads = rc->hits + rc->misses;
+        printf("Record cache: %llu hits, %llu misses (%.1f%% hit ratio), %llu evictions, %llu invalidations\n",
+               (unsigned long long)rc->hits, (unsigned long long)rc->misses, reads ? 100.0 * rc->hits / reads : 0.0,
+               (unsigned long long)rc->evictions, (unsigned long long)rc->invalidations);
+    }
+
+    // Let an archiving pass finish before the files are flushed
+    txn_archiver_stop();
+    const txn_archive_stats_t *ar = txn_archive_stats();
+    if (ar->rows > 0) {
+        printf("Txn archive: %llu rows in %llu bytes, %llu blocks decompressed, %llu cache hits\n",
+               (unsigned long long)ar->rows, (unsigned long long)ar->bytes,
+               (unsigned long long)ar->blocks_decoded, (unsigned long long)ar->cache_hits);
+    }
+
+    const txn_range_stats_t *rs = txn_log_range_stats();
+    if (rs->scans > 0) {
+        printf("Txn range scans: %llu scans, %llu segments read, %llu skipped by their footers\n",
+               (unsigned long long)rs->scans, (unsigned long long)rs->segments_read,
+               (unsigned long long)rs->segments_skipped);
+    }
+
+    // Write back pages the flusher has not reached yet; the tables use the files from here on
+    int pooled = buffer_pool_enabled();
+    buffer_pool_shutdown();
+    if (pooled) {
+        const bp_stats_t *bp = buffer_pool_stats();
+        printf("Buffer pool: %llu hits, %llu misses, %llu evictions, %llu write-backs\n",
+               (unsigned long long)bp->hits, (unsigned long long)bp->misses,
+               (unsigned long long)bp->evictions, (unsigned long long)bp->writebacks);
+    }
+    
+    // Final balance checkpoint (log mode)
+    balance_log_shutdown();
+    if (balance_log_enabled()) {
+        const balance_log_stats_t *bl = balance_log_stats();
+        printf("Balance log: %llu checkpoints, %llu rows replayed, checkpoint at row %llu\n",
+               (unsigned long long)bl->checkpoints, (unsigned long long)bl->rows_replayed,
+               (unsigned long long)bl->log_rows);
+    }
     
     printf("Server main loop exited. Goodbye.\n");
     return 0;
@@ -0,0 +1,562 @@
+#include "table.h"
+#include "buffer_pool.h"
+#include "record_cache.h"
+#include <sys/stat.h>
+#include <sched.h>
+
+/*
+ * --- TABLE ENGINE MODULE (Shared read/write/index logic for record tables) ---
+ * Row N of a table lives at N * rec_size. Keyed tables keep key -> row in 'primary',
+ * built in one sequential pass and extended as rows are appended; dense tables
+ * compute the row from the key. A lookup that misses re-checks the file for rows
+ * appended by another process (e.g. bootstrap) before giving up. Pooled tables read
+ * and rewrite rows through the buffer pool; index builds and appends use the file.
+ * Cached tables fill the record cache from table_read under the shared record lock, and
+ * every in-place write refreshes (or, if it failed, drops) the entry under the exclusive
+ * one, so a read served from the cache never returns a record older than its row.
+ *
+ * Snapshots read without locks: every in-place rewrite stamps its row with a commit
+ * number and, while a snapshot is running, keeps the image it replaced.
+ *
+ * Lock order: table lock, then record lock, then the fcntl file lock, then the index lock.
+ */
+
+#define TABLE_SCAN_CHUNK 64     // Rows per pread during builds and scans
+
+static off_t table_row_offset(const record_table_t *t, uint64_t row) {
+    return (off_t)(row * t->rec_size);
+}
+
+static int table_uses_pool(const record_table_t *t) {
+    return t->pooled && buffer_pool_enabled();
+}
+
+static int table_uses_cache(const record_table_t *t) {
+    return t->cached && record_cache_enabled();
+}
+
+// A row was rewritten in place (caller holds its exclusive record lock)
+static void table_cache_written(record_table_t *t, uint64_t key, const void *rec, int success) {
+    if (!table_uses_cache(t)) return;
+    if (success) rc_put(t->table, key, t->rec_size, rec);
+    else rc_invalidate(t->table, key);
+}
+
+// Read up to 'max' rows from 'row' (fewer at a pool page boundary); 0 past EOF
+static size_t table_load_rows(record_table_t *t, int fd, uint64_t row, size_t max, void *out) {
+    if (table_uses_pool(t)) return (size_t)bp_read_rows(t->table, t->rec_size, row, max, out);
+    ssize_t got = pread(fd, out, max * t->rec_size, table_row_offset(t, row));
+    return got > 0 ? (size_t)got / t->rec_size : 0;
+}
+
+// Rewrite one existing row (in the pool page, or in the file)
+static int table_store_row(record_table_t *t, int fd, uint64_t row, const void *rec) {
+    if (table_uses_pool(t)) return bp_write_row(t->table, t->rec_size, row, rec);
+    return pwrite(fd, rec, t->rec_size, table_row_offset(t, row)) == (ssize_t)t->rec_size;
+}
+
+/*
+ * --- ROW VERSIONS (Write stamps + saved images for snapshots) ---
+ * A row's stamp is 2 * the commit that last rewrote it, odd while a rewrite is in
+ * flight. A rewrite is published (new commit number, old image saved if any snapshot
+ * is running) after its index hook, under the same index write lock, so a snapshot
+ * begun under the index read lock agrees with the secondary indexes it reads.
+ */
+typedef struct table_version {
+    uint64_t until;                 // First commit that no longer sees this image
+    struct table_version *next;     // Older image of the same row
+    char rec[];
+} table_version_t;
+
+static _Atomic uint64_t *table_version_word(record_table_t *t, uint64_t row, int create) {
+    uint64_t chunk = row / TABLE_VERSION_CHUNK_ROWS;
+    if (chunk >= TABLE_VERSION_CHUNKS) return NULL;
+    _Atomic uint64_t *words = atomic_load_explicit(&t->row_versions[chunk], memory_order_acquire);
+    if (words == NULL && create) {
+        _Atomic uint64_t *fresh = calloc(TABLE_VERSION_CHUNK_ROWS, sizeof(*fresh));
+        if (fresh == NULL) return NULL;
+        if (atomic_compare_exchange_strong(&t->row_versions[chunk], &words, fresh)) words = fresh;
+        else free(fresh);
+    }
+    return words ? &words[row % TABLE_VERSION_CHUNK_ROWS] : NULL;
+}
+
+static uint64_t table_row_stamp(record_table_t *t, uint64_t row) {
+    _Atomic uint64_t *w = table_version_word(t, row, 0);
+    return w ? atomic_load_explicit(w, memory_order_acquire) : 0;
+}
+
+// Before rewriting 'row' in place (caller holds the row's writer lock)
+static void table_version_begin(record_table_t *t, uint64_t row) {
+    _Atomic uint64_t *w = table_version_word(t, row, 1);
+    if (w == NULL) return;
+    atomic_store_explicit(w, atomic_load_explicit(w, memory_order_relaxed) | 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void table_version_save(record_table_t *t, uint64_t row, uint64_t until, const void *old_rec) {
+    table_version_t *v = malloc(sizeof(table_version_t) + t->rec_size);
+    int kept = 0;
+    if (v != NULL) {
+        v->until = until;
+        memcpy(v->rec, old_rec, t->rec_size);
+        pthread_mutex_lock(&t->versions_lock);
+        int64_t head = id_index_get(&t->versions, row + 1);
+        v->next = (head >= 0) ? (table_version_t *)(intptr_t)head : NULL;
+        kept = id_index_put(&t->versions, row + 1, (int64_t)(intptr_t)v);
+        pthread_mutex_unlock(&t->versions_lock);
+        if (!kept) free(v);
+    }
+    if (kept) {
+        atomic_fetch_add_explicit(&t->stats.versions_saved, 1, memory_order_relaxed);
+    } else {
+        // Running snapshots read this row's current image instead of skipping it
+        atomic_fetch_add_explicit(&t->stats.versions_lost, 1, memory_order_relaxed);
+        fprintf(stderr, "Out of memory keeping an old row image of table %d; snapshots will read row %llu as current\n",
+                (int)t->table, (unsigned long long)row);
+    }
+}
+
+// After the rewrite (and its hook): stamp the row; keep 'old_rec' if a snapshot may need it
+static void table_version_publish(record_table_t *t, uint64_t row, const void *old_rec) {
+    uint64_t seq = atomic_fetch_add(&t->commit_seq, 1) + 1;
+    if (old_rec != NULL && atomic_load(&t->snapshots) > 0) table_version_save(t, row, seq, old_rec);
+    _Atomic uint64_t *w = table_version_word(t, row, 0);
+    if (w) atomic_store_explicit(w, seq * 2, memory_order_release);
+}
+
+// Image of 'row' as of commit 'seq': the oldest saved image still valid after it
+static int table_version_find(record_table_t *t, uint64_t row, uint64_t seq, void *out) {
+    pthread_mutex_lock(&t->versions_lock);
+    int64_t head = id_index_get(&t->versions, row + 1);
+    table_version_t *found = NULL;
+    for (table_version_t *v = (head >= 0) ? (table_version_t *)(intptr_t)head : NULL; v && v->until > seq; v = v->next) {
+        found = v;
+    }
+    if (found) memcpy(out, found->rec, t->rec_size);
+    pthread_mutex_unlock(&t->versions_lock);
+    return found != NULL;
+}
+
+static void table_version_chain_free(table_version_t *v) {
+    while (v) {
+        table_version_t *next = v->next;
+        free(v);
+        v = next;
+    }
+}
+
+// Drop every saved image (caller holds versions_lock and no snapshot is running)
+static void table_versions_free(record_table_t *t) {
+    for (size_t i = 0; i < t->versions.capacity; i++) {
+        id_index_slot_t *slot = &t->versions.slots[i];
+        if (slot->key == 0 || slot->value < 0) continue;
+        table_version_chain_free((table_version_t *)(intptr_t)slot->value);
+    }
+    id_index_free(&t->versions);
+}
+
+// Drop the images no snapshot at or after 'oldest' can see: until <= oldest. Chains run
+// newest first, so each is cut at its first such image (caller holds versions_lock).
+// Deleting a row shifts a later slot of its probe run into 'i', so 'i' is looked at again.
+static void table_versions_prune(record_table_t *t, uint64_t oldest) {
+    for (size_t i = 0; i < t->versions.capacity; i++) {
+        id_index_slot_t *slot = &t->versions.slots[i];
+        if (slot->key == 0 || slot->value < 0) continue;
+        table_version_t *head = (table_version_t *)(intptr_t)slot->value;
+        if (head->until <= oldest) {
+            table_version_chain_free(head);
+            id_index_del(&t->versions, slot->key);
+            i--;
+            continue;
+        }
+        table_version_t *v = head;
+        while (v->next && v->next->until > oldest) v = v->next;
+        table_version_chain_free(v->next);
+        v->next = NULL;
+    }
+}
+
+// One row as of the snapshot; 0 if it did not exist then
+static int table_snapshot_row(record_table_t *t, int fd, const table_snapshot_t *snap, uint64_t row, void *out) {
+    if (row >= snap->rows) return 0;
+    for (;;) {
+        uint64_t stamp = table_row_stamp(t, row);
+        if (stamp & 1) {
+            sched_yield();      // Rewrite in flight
+            continue;
+        }
+        // No saved image means it could not be kept (versions_lost): fall back to the current row
+        if (stamp / 2 > snap->seq && table_version_find(t, row, snap->seq, out)) return 1;
+        if (table_load_rows(t, fd, row, 1, out) != 1) return 0;
+        atomic_thread_fence(memory_order_acquire);
+        if (table_row_stamp(t, row) == stamp) return 1;
+    }
+}
+
+// Index every row between 'covered' and EOF (caller holds the index write lock)
+static void table_scan_tail(record_table_t *t, int fd) {
+    char *chunk = malloc(TABLE_SCAN_CHUNK * t->rec_size);
+    if (chunk == NULL) return;
+    ssize_t got;
+    while ((got = pread(fd, chunk, TABLE_SCAN_CHUNK * t->rec_size, table_row_offset(t, t->covered))) >= (ssize_t)t->rec_size) {
+        for (size_t i = 0; i < (size_t)got / t->rec_size; i++) {
+            const char *rec = chunk + i * t->rec_size;
+            if (!t->dense) id_index_put(&t->primary, t->key_of(rec), t->covered);
+            if (t->hooks.on_insert) t->hooks.on_insert(rec, t->covered);
+            t->covered++;
+        }
+    }
+    free(chunk);
+}
+
+// One-time build: sizes the primary index and makes one sequential pass
+int table_build(record_table_t *t) {
+    if (atomic_load_explicit(&t->built, memory_order_acquire)) return 1;
+    int fd = db_table_fd(t->table);
+    if (fd < 0) return 0;
+    db_file_lock(t->table, LOCK_SHARED);    // Keep other processes' appends out of the build
+    pthread_rwlock_wrlock(&t->index_lock);
+    if (!atomic_load(&t->built)) {
+        struct stat st;
+        uint64_t rows = (fstat(fd, &st) == 0) ? st.st_size / t->rec_size : 0;
+        if (!t->dense) id_index_init(&t->primary, rows);
+        t->covered = (t->dense && t->hooks.build_from) ? t->hooks.build_from() : 0;
+        if (t->covered > rows) t->covered = 0;      // File was replaced: start over
+        table_scan_tail(t, fd);
+        atomic_store_explicit(&t->built, 1, memory_order_release);
+    }
+    pthread_rwlock_unlock(&t->index_lock);
+    db_file_unlock(t->table, LOCK_SHARED);
+    return 1;
+}
+
+int table_catch_up(record_table_t *t) {
+    int fd = db_table_fd(t->table);
+    struct stat st;
+    if (fd < 0 || !table_build(t) || fstat(fd, &st) != 0) return 0;
+    int grew = 0;
+    db_file_lock(t->table, LOCK_SHARED);
+    pthread_rwlock_wrlock(&t->index_lock);
+    if (st.st_size >= table_row_offset(t, t->covered + 1)) {
+        uint64_t before = t->covered;
+        table_scan_tail(t, fd);
+        grew = (t->covered > before);
+    }
+    pthread_rwlock_unlock(&t->index_lock);
+    db_file_unlock(t->table, LOCK_SHARED);
+    return grew;
+}
+
+int table_has_unindexed(record_table_t *t) {
+    int fd = db_table_fd(t->table);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) return 0;
+    pthread_rwlock_rdlock(&t->index_lock);
+    int grew = t->built && st.st_size >= table_row_offset(t, t->covered + 1);
+    pthread_rwlock_unlock(&t->index_lock);
+    return grew;
+}
+
+static int64_t table_lookup(record_table_t *t, uint64_t key) {
+    pthread_rwlock_rdlock(&t->index_lock);
+    int64_t row;
+    if (t->dense) {
+        row = (key >= 1 && key <= t->covered) ? (int64_t)(key - 1) : -1;
+    } else {
+        row = id_index_get(&t->primary, key);
+    }
+    pthread_rwlock_unlock(&t->index_lock);
+    return row;
+}
+
+int64_t table_find(record_table_t *t, uint64_t key) {
+    table_build(t);
+    atomic_fetch_add_explicit(&t->stats.lookups, 1, memory_order_relaxed);
+    int64_t row = table_lookup(t, key);
+    if (row < 0 && table_catch_up(t)) {
+        row = table_lookup(t, key);
+    }
+    if (row < 0) atomic_fetch_add_explicit(&t->stats.lookup_misses, 1, memory_order_relaxed);
+    return row;
+}
+
+uint64_t table_row_count(record_table_t *t) {
+    int fd = db_table_fd(t->table);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) return 0;
+    return st.st_size / t->rec_size;
+}
+
+// Read by key under a shared record lock (from the record cache when it holds the key)
+int table_read(record_table_t *t, uint64_t key, void *out) {
+    if (table_uses_cache(t) && rc_get(t->table, key, t->rec_size, out)) {
+        atomic_fetch_add_explicit(&t->stats.reads, 1, memory_order_relaxed);
+        return 1;
+    }
+    int64_t row = table_find(t, key);
+    if (row < 0) return 0;
+    int fd = db_table_fd(t->table);
+    _Alignas(16) char tmp[TABLE_MAX_REC_SIZE];
+    int found = 0;
+    lm_lock_record(t->table, key, LOCK_SHARED);
+    if (table_load_rows(t, fd, row, 1, tmp) == 1 && t->key_of(tmp) == key) {
+        memcpy(out, tmp, t->rec_size);
+        found = 1;
+        // Filled under the record lock, so no write can slip in between
+        if (table_uses_cache(t)) rc_put(t->table, key, t->rec_size, tmp);
+    }
+    lm_unlock_record(t->table, key, LOCK_SHARED);
+    atomic_fetch_add_explicit(&t->stats.reads, 1, memory_order_relaxed);
+    return found;
+}
+
+// Atomic R-M-W: the modifier edits a copy under the record lock; returns 1 once written
+int table_update(record_table_t *t, uint64_t key, int (*modifier)(void *rec, void *data), void *data) {
+    return table_update_then(t, key, modifier, NULL, data);
+}
+
+int table_update_then(record_table_t *t, uint64_t key, int (*modifier)(void *rec, void *data),
+                      void (*after)(const void *rec, int written, void *data), void *data) {
+    int64_t row = table_find(t, key);
+    if (row < 0) return 0;
+    int fd = db_table_fd(t->table);
+    _Alignas(16) char old[TABLE_MAX_REC_SIZE], tmp[TABLE_MAX_REC_SIZE];
+    int success = 0;
+
+    lm_lock_record(t->table, key, LOCK_EXCLUSIVE);
+    if (table_load_rows(t, fd, row, 1, old) == 1 && t->key_of(old) == key) {
+        memcpy(tmp, old, t->rec_size);
+        if (modifier(tmp, data)) {
+            table_version_begin(t, row);
+            // A caller that needs the row on disk gets it in the file before the pool, cache
+            // and indexes see it, so a failed write leaves all of them on the old row
+            if (after && table_uses_pool(t)) success = bp_write_row_through(t->table, t->rec_size, row, tmp);
+            else success = table_store_row(t, fd, row, tmp);
+            table_cache_written(t, key, tmp, success);
+            void (*hook)(const void *, const void *) = success ? t->hooks.on_update : t->hooks.on_update_failed;
+            if (hook) pthread_rwlock_wrlock(&t->index_lock);
+            if (hook) hook(old, tmp);
+            table_version_publish(t, row, old);
+            if (hook) pthread_rwlock_unlock(&t->index_lock);
+            if (after) after(tmp, success, data);
+        }
+    }
+    lm_unlock_record(t->table, key, LOCK_EXCLUSIVE);
+    if (success) atomic_fetch_add_explicit(&t->stats.updates, 1, memory_order_relaxed);
+    return success;
+}
+
+// Upsert: overwrite the record with the same key, or append it
+int table_write(record_table_t *t, const void *rec) {
+    uint64_t key = t->key_of(rec);
+    int64_t row = table_find(t, key);
+    if (row < 0) return t->dense ? 0 : table_append(t, (void *)rec, NULL);    // Dense keys come from table_append
+
+    int fd = db_table_fd(t->table);
+    _Alignas(16) char old[TABLE_MAX_REC_SIZE];
+    int success = 0;
+    lm_lock_record(t->table, key, LOCK_EXCLUSIVE);
+    if (table_load_rows(t, fd, row, 1, old) == 1) {
+        table_version_begin(t, row);
+        success = table_store_row(t, fd, row, rec);
+        table_cache_written(t, key, rec, success);
+        int hook = (success && t->hooks.on_update);
+        if (hook) pthread_rwlock_wrlock(&t->index_lock);
+        if (hook) t->hooks.on_update(old, rec);
+        table_version_publish(t, row, old);
+        if (hook) pthread_rwlock_unlock(&t->index_lock);
+    }
+    lm_unlock_record(t->table, key, LOCK_EXCLUSIVE);
+    if (success) atomic_fetch_add_explicit(&t->stats.updates, 1, memory_order_relaxed);
+    return success;
+}
+
+// Append under the exclusive table lock; the index write lock keeps lookups from
+// seeing a half-written row
+int table_append(record_table_t *t, void *rec, void (*assign_key)(void *rec, uint64_t row)) {
+    int fd = db_table_fd(t->table);
+    if (fd < 0 || !table_build(t)) return 0;
+    db_table_lock(t->table, LOCK_EXCLUSIVE);
+    pthread_rwlock_wrlock(&t->index_lock);
+    uint64_t row = lseek(fd, 0, SEEK_END) / t->rec_size;
+    if (assign_key) assign_key(rec, row);
+    int success = (pwrite(fd, rec, t->rec_size, table_row_offset(t, row)) == (ssize_t)t->rec_size);
+    if (!success) {
+        ftruncate(fd, table_row_offset(t, row));    // Never leave a partial record behind
+    }
+    table_scan_tail(t, fd);     // Indexes the new row (and any appended by another process)
+    pthread_rwlock_unlock(&t->index_lock);
+    db_table_unlock(t->table, LOCK_EXCLUSIVE);
+    if (success) atomic_fetch_add_explicit(&t->stats.appends, 1, memory_order_relaxed);
+    return success;
+}
+
+int table_scan(record_table_t *t, uint64_t from_row, int (*visit)(const void *rec, uint64_t row, void *data), void *data) {
+    int fd = db_table_fd(t->table);
+    if (fd < 0) return -1;
+    char *chunk = malloc(TABLE_SCAN_CHUNK * t->rec_size);
+    if (chunk == NULL) return -1;
+
+    db_table_lock(t->table, LOCK_SHARED);
+    int visited = 0, stop = 0;
+    uint64_t row = from_row;
+    size_t got;
+    while (!stop && (got = table_load_rows(t, fd, row, TABLE_SCAN_CHUNK, chunk)) > 0) {
+        for (size_t i = 0; i < got; i++, row++) {
+            visited++;
+            if (!visit(chunk + i * t->rec_size, row, data)) {
+                stop = 1;
+                break;
+            }
+        }
+    }
+    db_table_unlock(t->table, LOCK_SHARED);
+    free(chunk);
+    atomic_fetch_add_explicit(&t->stats.rows_scanned, visited, memory_order_relaxed);
+    return visited;
+}
+
+int table_put_rows(record_table_t *t, uint64_t first_row, const void *recs, size_t count) {
+    int fd = db_table_fd(t->table);
+    ssize_t want = (ssize_t)(count * t->rec_size);
+    if (fd < 0) return 0;
+
+    // Snapshots begin under the index read lock, so this cannot change until we return
+    char *old = NULL;
+    if (atomic_load(&t->snapshots) > 0 && (old = malloc(want)) != NULL &&
+        table_load_rows(t, fd, first_row, count, old) != count) {
+        free(old);
+        old = NULL;
+    }
+    for (size_t i = 0; i < count; i++) table_version_begin(t, first_row + i);
+    int success = 1;
+    if (table_uses_pool(t)) {
+        for (size_t i = 0; i < count && success; i++) {
+            success = table_store_row(t, fd, first_row + i, (const char *)recs + i * t->rec_size);
+        }
+    } else {
+        success = (pwrite(fd, recs, want, table_row_offset(t, first_row)) == want);
+    }
+    for (size_t i = 0; i < count; i++) {
+        table_version_publish(t, first_row + i, old ? old + i * t->rec_size : NULL);
+    }
+    free(old);
+    if (success) atomic_fetch_add_explicit(&t->stats.updates, count, memory_order_relaxed);
+    return success;
+}
+
+int table_get_row(record_table_t *t, uint64_t row, void *out) {
+    int fd = db_table_fd(t->table);
+    if (fd < 0) return 0;
+    atomic_fetch_add_explicit(&t->stats.reads, 1, memory_order_relaxed);
+    return table_load_rows(t, fd, row, 1, out) == 1;
+}
+
+void table_index_lock(record_table_t *t, lock_mode_t mode) {
+    table_build(t);
+    if (mode == LOCK_EXCLUSIVE) pthread_rwlock_wrlock(&t->index_lock);
+    else pthread_rwlock_rdlock(&t->index_lock);
+}
+
+void table_index_unlock(record_table_t *t) {
+    pthread_rwlock_unlock(&t->index_lock);
+}
+
+/* --- SNAPSHOT READS --- */
+
+table_snapshot_t table_snapshot_begin_locked(record_table_t *t) {
+    atomic_fetch_add(&t->snapshots, 1);     // Before reading commit_seq: later rewrites keep their old image
+    pthread_mutex_lock(&t->versions_lock);
+    table_snapshot_t snap = { atomic_load(&t->commit_seq), t->covered };
+    if (t->snapshot_count == t->snapshot_cap) {
+        size_t cap = t->snapshot_cap ? t->snapshot_cap * 2 : 16;
+        uint64_t *seqs = realloc(t->snapshot_seqs, cap * sizeof(uint64_t));
+        if (seqs != NULL) {
+            t->snapshot_seqs = seqs;
+            t->snapshot_cap = cap;
+        }
+    }
+    if (t->snapshot_count < t->snapshot_cap) t->snapshot_seqs[t->snapshot_count++] = snap.seq;
+    else t->snapshots_untracked++;          // No pruning until it ends
+    pthread_mutex_unlock(&t->versions_lock);
+    return snap;
+}
+
+table_snapshot_t table_snapshot_begin(record_table_t *t) {
+    table_index_lock(t, LOCK_SHARED);
+    table_snapshot_t snap = table_snapshot_begin_locked(t);
+    table_index_unlock(t);
+    return snap;
+}
+
+// Frees the saved images only older snapshots could see: all of them once the last one ends
+void table_snapshot_end(record_table_t *t, const table_snapshot_t *snap) {
+    pthread_mutex_lock(&t->versions_lock);
+    size_t i = 0;
+    while (i < t->snapshot_count && t->snapshot_seqs[i] != snap->seq) i++;
+    if (i < t->snapshot_count) t->snapshot_seqs[i] = t->snapshot_seqs[--t->snapshot_count];
+    else if (t->snapshots_untracked > 0) t->snapshots_untracked--;
+    if (atomic_fetch_sub(&t->snapshots, 1) == 1) {
+        table_versions_free(t);
+    } else if (t->snapshots_untracked == 0 && t->snapshot_count > 0) {
+        uint64_t oldest = t->snapshot_seqs[0];
+        for (size_t j = 1; j < t->snapshot_count; j++) {
+            if (t->snapshot_seqs[j] < oldest) oldest = t->snapshot_seqs[j];
+        }
+        if (oldest > snap->seq) table_versions_prune(t, oldest);     // The oldest one just ended
+    }
+    pthread_mutex_unlock(&t->versions_lock);
+}
+
+int table_scan_snapshot(record_table_t *t, const table_snapshot_t *snap,
+                        int (*visit)(const void *rec, uint64_t row, void *data), void *data) {
+    int fd = db_table_fd(t->table);
+    if (fd < 0) return -1;
+    char *chunk = malloc(TABLE_SCAN_CHUNK * t->rec_size);
+    if (chunk == NULL) return -1;
+
+    _Alignas(16) char one[TABLE_MAX_REC_SIZE];
+    uint64_t stamps[TABLE_SCAN_CHUNK];
+    int visited = 0, stop = 0;
+    uint64_t row = 0;
+    while (!stop && row < snap->rows) {
+        size_t want = (snap->rows - row < TABLE_SCAN_CHUNK) ? snap->rows - row : TABLE_SCAN_CHUNK;
+        for (size_t i = 0; i < want; i++) stamps[i] = table_row_stamp(t, row + i);
+        size_t got = table_load_rows(t, fd, row, want, chunk);
+        if (got == 0) break;
+        atomic_thread_fence(memory_order_acquire);
+        for (size_t i = 0; i < got; i++, row++) {
+            const char *rec = chunk + i * t->rec_size;
+            // Rewritten since the snapshot began (or during the read): take the row on its own
+            if ((stamps[i] & 1) || stamps[i] / 2 > snap->seq || table_row_stamp(t, row) != stamps[i]) {
+                if (!table_snapshot_row(t, fd, snap, row, one)) continue;
+                rec = one;
+            }
+            visited++;
+            if (!visit(rec, row, data)) {
+                stop = 1;
+                break;
+            }
+        }
+    }
+    free(chunk);
+    atomic_fetch_add_explicit(&t->stats.rows_scanned, visited, memory_order_relaxed);
+    return visited;
+}
+
+int table_visit_keys_snapshot(record_table_t *t, const table_snapshot_t *snap, const uint64_t *keys, size_t count,
+                              int (*visit)(const void *rec, void *data), void *data) {
+    int fd = db_table_fd(t->table);
+    if (fd < 0) return -1;
+    _Alignas(16) char rec[TABLE_MAX_REC_SIZE];
+    int visited = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t row = table_lookup(t, keys[i]);
+        if (row < 0 || !table_snapshot_row(t, fd, snap, (uint64_t)row, rec)) continue;
+        visited++;
+        if (!visit(rec, data)) break;
+    }
+    atomic_fetch_add_explicit(&t->stats.reads, visited, memory_order_relaxed);
+    return visited;
+}
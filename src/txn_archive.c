@@ -0,0 +1,282 @@
+#define _GNU_SOURCE     // fallocate() hole punching on Linux
+#include "txn_archive.h"
+#include <sys/stat.h>
+#include <pthread.h>
+
+/*
+ * --- TRANSACTION ARCHIVE MODULE (Block-compressed cold rows) ---
+ * Blocks are written to txn_archive.db and synced before their entries are added to
+ * txn_archive.idx, so an entry only ever points at complete bytes. The index is small
+ * (one entry per 256 rows) and kept in memory; a read finds its block by binary search
+ * and decompresses it into a small cache shared by all readers.
+ */
+
+#if defined(__APPLE__)
+#define archive_datasync(fd) fsync(fd)
+#else
+#define archive_datasync(fd) fdatasync(fd)
+#endif
+
+#define ARCHIVE_ROW_MAX 51              // Five 10-byte varints + the type byte
+
+static pthread_mutex_t ar_lock = PTHREAD_MUTEX_INITIALIZER;
+static int ar_data_fd = -1, ar_index_fd = -1;
+static int ar_writable = 0;
+static txn_archive_block_t *ar_blocks = NULL;
+static size_t ar_block_count = 0, ar_block_capacity = 0;
+static uint64_t ar_rows = 0;            // Rows covered by ar_blocks
+static uint64_t ar_data_end = 0;        // End of the last block in txn_archive.db
+static txn_archive_stats_t ar_stats;
+
+typedef struct {
+    int64_t block;                      // Index into ar_blocks, -1 if empty
+    txn_disk_rec_t rows[TXN_ARCHIVE_BLOCK_ROWS];
+} ar_cached_block_t;
+static ar_cached_block_t ar_cache[TXN_ARCHIVE_CACHE_BLOCKS];
+static int ar_cache_next = 0;           // Round-robin replacement
+
+/* --- ROW CODEC (zigzag varints, each field relative to the previous row) --- */
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        *v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return p;
+    }
+    return NULL;                        // Truncated or overlong
+}
+
+static size_t archive_encode(const txn_disk_rec_t *rows, size_t count, uint8_t *out) {
+    txn_disk_rec_t prev;
+    memset(&prev, 0, sizeof(prev));
+    uint8_t *p = out;
+    for (size_t i = 0; i < count; i++) {
+        const txn_disk_rec_t *r = &rows[i];
+        p = put_varint(p, zigzag((int64_t)(r->txn_id - prev.txn_id - 1)));     // Usually 0
+        p = put_varint(p, zigzag((int64_t)r->from_account - prev.from_account));
+        p = put_varint(p, zigzag((int64_t)r->to_account - prev.to_account));
+        p = put_varint(p, zigzag(r->amount));
+        p = put_varint(p, zigzag((int64_t)r->time_delta - prev.time_delta));
+        *p++ = r->type;
+        prev = *r;
+    }
+    return (size_t)(p - out);
+}
+
+static int archive_decode(const uint8_t *in, size_t len, size_t count, txn_disk_rec_t *rows) {
+    const uint8_t *p = in, *end = in + len;
+    txn_disk_rec_t prev;
+    memset(&prev, 0, sizeof(prev));
+    for (size_t i = 0; i < count; i++) {
+        uint64_t v[5];
+        for (int f = 0; f < 5; f++) {
+            if ((p = get_varint(p, end, &v[f])) == NULL) return 0;
+        }
+        if (p >= end) return 0;
+        txn_disk_rec_t *r = &rows[i];
+        memset(r, 0, sizeof(*r));
+        r->txn_id = prev.txn_id + 1 + (uint64_t)unzigzag(v[0]);
+        r->from_account = (uint32_t)((int64_t)prev.from_account + unzigzag(v[1]));
+        r->to_account = (uint32_t)((int64_t)prev.to_account + unzigzag(v[2]));
+        r->amount = unzigzag(v[3]);
+        r->time_delta = (uint32_t)((int64_t)prev.time_delta + unzigzag(v[4]));
+        r->type = *p++;
+        prev = *r;
+    }
+    return p == end;
+}
+
+/* --- OPEN + INDEX --- */
+
+// Room for 'extra' more blocks in the in-memory index
+static int ar_blocks_reserve(size_t extra) {
+    if (ar_block_count + extra <= ar_block_capacity) return 1;
+    size_t capacity = ar_block_capacity ? ar_block_capacity : 64;
+    while (capacity < ar_block_count + extra) capacity *= 2;
+    txn_archive_block_t *grown = realloc(ar_blocks, capacity * sizeof(txn_archive_block_t));
+    if (grown == NULL) return 0;
+    ar_blocks = grown;
+    ar_block_capacity = capacity;
+    return 1;
+}
+
+static void ar_blocks_push(const txn_archive_block_t *blk) {
+    ar_blocks[ar_block_count++] = *blk;
+    ar_rows = blk->first_row + blk->rows;
+    ar_data_end = blk->offset + blk->length;
+}
+
+int txn_archive_open(int writable) {
+    pthread_mutex_lock(&ar_lock);
+    if (ar_index_fd >= 0) {
+        pthread_mutex_unlock(&ar_lock);
+        return 0;
+    }
+    for (int i = 0; i < TXN_ARCHIVE_CACHE_BLOCKS; i++) ar_cache[i].block = -1;
+
+    int flags = writable ? (O_RDWR | O_CREAT) : O_RDONLY;
+    int ifd = open(TXN_ARCHIVE_INDEX_FILE, flags, 0666);
+    int dfd = open(TXN_ARCHIVE_DB_FILE, flags, 0666);
+    struct stat ist, dst;
+    if (ifd < 0 || dfd < 0 || fstat(ifd, &ist) != 0 || fstat(dfd, &dst) != 0) {
+        int missing = (!writable && errno == ENOENT);
+        if (ifd >= 0) close(ifd);
+        if (dfd >= 0) close(dfd);
+        pthread_mutex_unlock(&ar_lock);
+        return missing ? 0 : -1;        // Never archived: nothing to read
+    }
+
+    // Keep every block up to the first one that is not fully on disk
+    txn_archive_block_t blk;
+    for (off_t pos = 0; pread(ifd, &blk, sizeof(blk), pos) == sizeof(blk); pos += sizeof(blk)) {
+        if (blk.first_row != ar_rows || blk.offset != ar_data_end || blk.rows == 0 ||
+            blk.rows > TXN_ARCHIVE_BLOCK_ROWS || blk.offset + blk.length > (uint64_t)dst.st_size) {
+            break;
+        }
+        if (!ar_blocks_reserve(1)) break;
+        ar_blocks_push(&blk);
+    }
+    if (writable) {
+        // Drop a torn tail left by a crash mid-append. Only the server opens the archive
+        // writable, and it holds DB_LOCK_FILE, so this cannot cut a live archiver's append
+        off_t index_end = (off_t)(ar_block_count * sizeof(txn_archive_block_t));
+        if ((ist.st_size != index_end && ftruncate(ifd, index_end) != 0) ||
+            (dst.st_size != (off_t)ar_data_end && ftruncate(dfd, (off_t)ar_data_end) != 0)) {
+            perror("txn archive");
+        }
+    }
+    ar_index_fd = ifd;
+    ar_data_fd = dfd;
+    ar_writable = writable;
+    atomic_store(&ar_stats.rows, ar_rows);
+    atomic_store(&ar_stats.bytes, ar_data_end);
+    pthread_mutex_unlock(&ar_lock);
+    return 0;
+}
+
+uint64_t txn_archive_rows(void) {
+    pthread_mutex_lock(&ar_lock);
+    uint64_t rows = ar_rows;
+    pthread_mutex_unlock(&ar_lock);
+    return rows;
+}
+
+/* --- READ (Only the block holding the row is decompressed) --- */
+
+// Decompressed copy of block 'b' (caller holds ar_lock); NULL if it is damaged
+static const txn_disk_rec_t *ar_block_rows(size_t b) {
+    for (int i = 0; i < TXN_ARCHIVE_CACHE_BLOCKS; i++) {
+        if (ar_cache[i].block == (int64_t)b) {
+            atomic_fetch_add(&ar_stats.cache_hits, 1);
+            return ar_cache[i].rows;
+        }
+    }
+    const txn_archive_block_t *blk = &ar_blocks[b];
+    uint8_t buf[TXN_ARCHIVE_BLOCK_ROWS * ARCHIVE_ROW_MAX];
+    ar_cached_block_t *slot = &ar_cache[ar_cache_next];
+    if (blk->length > sizeof(buf) || pread(ar_data_fd, buf, blk->length, (off_t)blk->offset) != (ssize_t)blk->length ||
+        fnv1a_update(FNV1A_INIT, buf, blk->length) != blk->checksum) {
+        return NULL;
+    }
+    slot->block = -1;
+    if (!archive_decode(buf, blk->length, blk->rows, slot->rows)) return NULL;
+    slot->block = (int64_t)b;
+    ar_cache_next = (ar_cache_next + 1) % TXN_ARCHIVE_CACHE_BLOCKS;
+    atomic_fetch_add(&ar_stats.blocks_decoded, 1);
+    return slot->rows;
+}
+
+size_t txn_archive_read(uint64_t row, size_t max, txn_disk_rec_t *out) {
+    pthread_mutex_lock(&ar_lock);
+    size_t copied = 0;
+    if (row < ar_rows && max > 0) {
+        // Last block starting at or before 'row'
+        size_t lo = 0, hi = ar_block_count;
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (ar_blocks[mid].first_row <= row) lo = mid;
+            else hi = mid;
+        }
+        const txn_disk_rec_t *rows = ar_block_rows(lo);
+        if (rows != NULL) {
+            uint64_t skip = row - ar_blocks[lo].first_row;
+            copied = ar_blocks[lo].rows - skip;
+            if (copied > max) copied = max;
+            memcpy(out, rows + skip, copied * sizeof(txn_disk_rec_t));
+        }
+    }
+    pthread_mutex_unlock(&ar_lock);
+    return copied;
+}
+
+/* --- APPEND (Archiver) --- */
+
+int txn_archive_append(const txn_disk_rec_t *rows, size_t count) {
+    pthread_mutex_lock(&ar_lock);
+    size_t nblocks = (count + TXN_ARCHIVE_BLOCK_ROWS - 1) / TXN_ARCHIVE_BLOCK_ROWS;
+    txn_archive_block_t *entries = malloc((nblocks ? nblocks : 1) * sizeof(txn_archive_block_t));
+    uint8_t buf[TXN_ARCHIVE_BLOCK_ROWS * ARCHIVE_ROW_MAX];
+    int ok = (ar_writable && entries != NULL && count > 0 && ar_blocks_reserve(nblocks));
+
+    uint64_t offset = ar_data_end;
+    for (size_t b = 0; ok && b < nblocks; b++) {
+        size_t first = b * TXN_ARCHIVE_BLOCK_ROWS;
+        size_t n = count - first < TXN_ARCHIVE_BLOCK_ROWS ? count - first : TXN_ARCHIVE_BLOCK_ROWS;
+        size_t len = archive_encode(rows + first, n, buf);
+        entries[b] = (txn_archive_block_t){ ar_rows + first, (uint32_t)n, (uint32_t)len, offset,
+                                            fnv1a_update(FNV1A_INIT, buf, len) };
+        ok = (pwrite(ar_data_fd, buf, len, (off_t)offset) == (ssize_t)len);
+        offset += len;
+    }
+    // Blocks first, then the entries that point at them
+    off_t index_end = (off_t)(ar_block_count * sizeof(txn_archive_block_t));
+    ssize_t want = (ssize_t)(nblocks * sizeof(txn_archive_block_t));
+    ok = ok && archive_datasync(ar_data_fd) == 0 &&
+         pwrite(ar_index_fd, entries, want, index_end) == want && archive_datasync(ar_index_fd) == 0;
+
+    if (ok) {
+        for (size_t b = 0; b < nblocks; b++) ar_blocks_push(&entries[b]);
+        atomic_store(&ar_stats.rows, ar_rows);
+        atomic_store(&ar_stats.bytes, ar_data_end);
+    } else if (ar_writable) {
+        // Forget the partial append; the next attempt starts over from the same rows
+        if (ftruncate(ar_index_fd, index_end) != 0 || ftruncate(ar_data_fd, (off_t)ar_data_end) != 0) {
+            perror("txn archive");
+        }
+    }
+    free(entries);
+    pthread_mutex_unlock(&ar_lock);
+    return ok;
+}
+
+void txn_archive_release_hot(int fd, off_t offset, off_t length) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) != 0 && errno != EOPNOTSUPP) {
+        perror("txn archive: release rows");
+    }
+#else
+    (void)fd; (void)offset; (void)length;   // The hot copy stays; reads still use the archive
+#endif
+}
+
+const txn_archive_stats_t *txn_archive_stats(void) {
+    return &ar_stats;
+}
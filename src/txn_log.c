@@ -0,0 +1,768 @@
+#include "txn_log.h"
+#include "txn_archive.h"
+#include "utils.h"
+#include "db_index.h"
+#include <sys/stat.h>
+#include <pthread.h>
+
+/*
+ * --- TRANSACTION LOG MODULE (Writer thread + group commit) ---
+ * Callers queue their record and sleep; a single writer thread drains the queue,
+ * encodes the whole batch into one contiguous pwrite and, unless the policy is "none", one
+ * fdatasync. Each caller is woken only after its batch has been committed, so a
+ * successful deposit/withdraw/transfer is on disk before the client hears about it.
+ */
+
+#if defined(__APPLE__)
+#define log_datasync(fd) fsync(fd)     // No fdatasync in the macOS SDK
+#else
+#define log_datasync(fd) fdatasync(fd)
+#endif
+
+typedef struct txn_log_req {
+    txn_rec_t *tx;
+    int group;                  // Rows committed together from here (0 = joins the previous one)
+    int done;                   // 0 = queued, 1 = committed, -1 = failed
+    struct txn_log_req *next;
+} txn_log_req_t;
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_work = PTHREAD_COND_INITIALIZER;     // Writer: requests queued
+static pthread_cond_t log_done = PTHREAD_COND_INITIALIZER;     // Callers: a batch finished
+static txn_log_req_t *log_head = NULL, *log_tail = NULL;
+static int log_pending = 0;
+
+static txn_fsync_policy_t log_policy = TXN_FSYNC_GROUP;
+static long log_window_us = TXN_GROUP_WINDOW_US_DEFAULT;
+static int log_batch_max = TXN_LOG_BATCH_MAX;
+static int log_writer_running = 0;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+static void txn_log_start(void);
+
+/*
+ * --- COMPACT ROW FORMAT (transactions.db v1) ---
+ * A 32-byte header (magic, version, base time) followed by 32-byte rows holding a
+ * type code, the amount in minor units and the time as seconds past the base. Only this
+ * module reads or writes rows; everyone else sees decoded txn_rec_t values.
+ */
+_Static_assert(sizeof(txn_file_header_t) == TXN_DISK_REC_SIZE, "header must be one row long");
+_Static_assert(sizeof(txn_disk_rec_t) == TXN_DISK_REC_SIZE, "txn_disk_rec_t layout changed");
+
+static int64_t log_base_time = 0;
+static int log_format_ok = 0;           // Header checked; appends refused otherwise
+
+static off_t txn_row_offset(uint64_t row) {
+    return (off_t)(row + 1) * TXN_DISK_REC_SIZE;
+}
+
+static uint64_t txn_row_count(off_t end) {
+    return end > TXN_DISK_REC_SIZE ? (uint64_t)(end - TXN_DISK_REC_SIZE) / TXN_DISK_REC_SIZE : 0;
+}
+
+static void txn_encode(const txn_rec_t *tx, int64_t base_time, txn_disk_rec_t *row) {
+    memset(row, 0, sizeof(*row));
+    row->txn_id = tx->txn_id;
+    row->from_account = tx->from_account;
+    row->to_account = tx->to_account;
+    row->amount = tx->amount;
+    row->time_delta = tx->timestamp > base_time ? (uint32_t)(tx->timestamp - base_time) : 0;
+    row->type = (uint8_t)tx->type;
+}
+
+static void txn_decode(const txn_disk_rec_t *row, txn_rec_t *tx) {
+    tx->txn_id = row->txn_id;
+    tx->from_account = row->from_account;
+    tx->to_account = row->to_account;
+    tx->amount = row->amount;
+    tx->timestamp = (time_t)(log_base_time + row->time_delta);
+    tx->type = (txn_type_t)row->type;
+}
+
+/*
+ * --- ARCHIVED ROWS (txn_archive.c holds a prefix of the log) ---
+ * Rows below archived_rows are read from the archive: their copies in transactions.db
+ * may already be holes. The archiver raises the boundary under the write lock before
+ * releasing any row, so a reader that saw the old boundary has finished by then.
+ */
+static pthread_rwlock_t archive_boundary_lock = PTHREAD_RWLOCK_INITIALIZER;
+static uint64_t archived_rows = 0;
+
+// Up to 'max' stored rows from 'row' (fewer at an archive block boundary); 0 past EOF
+static size_t txn_read_disk_rows(int fd, uint64_t row, size_t max, txn_disk_rec_t *out) {
+    size_t got = 0;
+    pthread_rwlock_rdlock(&archive_boundary_lock);
+    if (row < archived_rows) {
+        got = txn_archive_read(row, max < archived_rows - row ? max : archived_rows - row, out);
+    } else {
+        ssize_t n = pread(fd, out, max * sizeof(txn_disk_rec_t), txn_row_offset(row));
+        got = n > 0 ? (size_t)n / sizeof(txn_disk_rec_t) : 0;
+    }
+    pthread_rwlock_unlock(&archive_boundary_lock);
+    return got;
+}
+
+static int txn_read_row(int fd, uint64_t row, txn_rec_t *tx) {
+    txn_disk_rec_t disk;
+    if (txn_read_disk_rows(fd, row, 1, &disk) != 1) return 0;
+    txn_decode(&disk, tx);
+    return 1;
+}
+
+// Check the header, writing one into an empty file (caller holds DB_TRANSACTIONS exclusively)
+static int txn_file_open_format(int fd) {
+    txn_file_header_t hdr;
+    if (lseek(fd, 0, SEEK_END) == 0) {
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = TXN_FILE_MAGIC;
+        hdr.version = TXN_FILE_VERSION;
+        hdr.base_time = time(NULL);
+        hdr.record_size = TXN_DISK_REC_SIZE;
+        if (pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) return 0;
+    } else if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || hdr.magic != TXN_FILE_MAGIC ||
+               hdr.version != TXN_FILE_VERSION || hdr.record_size != TXN_DISK_REC_SIZE) {
+        return 0;
+    }
+    log_base_time = hdr.base_time;
+    return 1;
+}
+
+static txn_type_t txn_type_from_narration(const char *narration) {
+    if (strcmp(narration, "deposit") == 0) return TXN_DEPOSIT;
+    if (strcmp(narration, "withdraw") == 0) return TXN_WITHDRAW;
+    if (strcmp(narration, "transfer_out") == 0) return TXN_TRANSFER_OUT;
+    if (strcmp(narration, "transfer_in") == 0) return TXN_TRANSFER_IN;
+    if (strcmp(narration, "loan_deposit") == 0) return TXN_LOAN_DEPOSIT;
+    return 0;
+}
+
+// One-time rewrite of a pre-v1 transactions.db (176-byte rows with narration strings).
+// Rows keep their positions, so txn_postings.db stays valid.
+int txn_log_convert_legacy(void) {
+    int fd = open(TRANSACTIONS_DB_FILE, O_RDWR);
+    if (fd < 0) return 0;       // No transactions yet: nothing to convert
+    lock_file(fd);
+
+    struct stat st;
+    uint32_t magic = 0;
+    int rc = 0;
+    if (fstat(fd, &st) != 0) {
+        rc = -1;
+    } else if (st.st_size == 0 || (pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) && magic == TXN_FILE_MAGIC)) {
+        rc = 0;                 // Empty or already v1
+    } else if (st.st_size % sizeof(txn_legacy_rec_t) != 0) {
+        fprintf(stderr, "%s: unrecognised format\n", TRANSACTIONS_DB_FILE);
+        rc = -1;
+    } else {
+        // Base the relative timestamps on the oldest row
+        txn_legacy_rec_t old;
+        txn_file_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = TXN_FILE_MAGIC;
+        hdr.version = TXN_FILE_VERSION;
+        hdr.base_time = INT64_MAX;
+        hdr.record_size = TXN_DISK_REC_SIZE;
+        for (off_t pos = 0; pread(fd, &old, sizeof(old), pos) == sizeof(old); pos += sizeof(old)) {
+            if (old.timestamp < hdr.base_time) hdr.base_time = old.timestamp;
+        }
+
+        const char *tmp_path = TRANSACTIONS_DB_FILE ".migrating";
+        int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (out < 0 || pwrite(out, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+            rc = -1;
+        }
+        uint64_t row = 0;
+        for (off_t pos = 0; rc == 0 && pread(fd, &old, sizeof(old), pos) == sizeof(old); pos += sizeof(old), row++) {
+            txn_rec_t tx = { old.txn_id, old.from_account, old.to_account, money_from_double(old.amount), old.timestamp,
+                             txn_type_from_narration(old.narration) };
+            txn_disk_rec_t disk;
+            txn_encode(&tx, hdr.base_time, &disk);
+            if (pwrite(out, &disk, sizeof(disk), txn_row_offset(row)) != sizeof(disk)) rc = -1;
+        }
+        if (rc == 0 && fsync(out) == 0 && rename(tmp_path, TRANSACTIONS_DB_FILE) == 0) {
+            printf("Converted %s to the compact v%d format (%llu rows).\n",
+                   TRANSACTIONS_DB_FILE, TXN_FILE_VERSION, (unsigned long long)row);
+        } else {
+            rc = -1;
+            unlink(tmp_path);
+        }
+        if (out >= 0) close(out);
+    }
+    unlock_file(fd);
+    close(fd);
+    return rc;
+}
+
+/*
+ * --- POSTING INDEX (Per-account chains through transactions.db) ---
+ * txn_postings.db runs parallel to transactions.db: entry N names the account that
+ * row N belongs to and links to that account's previous row. The newest row of each
+ * account is kept in memory, so a history view follows one chain instead of reading
+ * the whole log. Both files and the heads are guarded by the DB_TRANSACTIONS lock.
+ */
+#define POSTING_SCAN_CHUNK 4096
+
+static id_index_t posting_heads;        // account_id -> newest row
+static uint64_t postings_covered = 0;   // Rows whose posting entry is known
+
+// Debits belong to the sender's history, credits (deposits, loans, transfers in) to the receiver's
+static uint32_t txn_owner(const txn_rec_t *tx) {
+    if (tx->type == TXN_WITHDRAW || tx->type == TXN_TRANSFER_OUT) {
+        return tx->from_account;
+    }
+    return tx->to_account;
+}
+
+// Chain 'row' onto its account and return its posting entry
+static txn_posting_t posting_link(const txn_rec_t *tx, uint64_t row) {
+    txn_posting_t post = { txn_owner(tx), 0, -1 };
+    post.prev = id_index_get(&posting_heads, post.account_id);
+    id_index_put(&posting_heads, post.account_id, row);
+    return post;
+}
+
+// Forget everything; the next catch-up re-reads txn_postings.db from the start
+static void postings_reset(void) {
+    id_index_free(&posting_heads);
+    postings_covered = 0;
+}
+
+// Bring the heads up to 'rows' log rows (caller holds DB_TRANSACTIONS exclusively).
+// Entries written by another process are read back; rows without one (a crash
+// between the two writes) are posted from transactions.db.
+static int postings_catch_up(uint64_t rows) {
+    int tfd = db_table_fd(DB_TRANSACTIONS);
+    int pfd = db_table_fd(DB_TXN_POSTINGS);
+    struct stat st;
+    if (tfd < 0 || pfd < 0 || fstat(pfd, &st) != 0) return 0;
+
+    uint64_t on_disk = st.st_size / sizeof(txn_posting_t);
+    if (on_disk > rows) {
+        if (ftruncate(pfd, rows * sizeof(txn_posting_t)) != 0) return 0;
+        on_disk = rows;
+        postings_reset();
+    } else if (postings_covered > on_disk) {
+        postings_reset();       // File shrank under us: rebuild from what is there
+    }
+
+    txn_posting_t chunk[POSTING_SCAN_CHUNK];
+    while (postings_covered < on_disk) {
+        uint64_t want = on_disk - postings_covered;
+        if (want > POSTING_SCAN_CHUNK) want = POSTING_SCAN_CHUNK;
+        ssize_t got = pread(pfd, chunk, want * sizeof(txn_posting_t), postings_covered * sizeof(txn_posting_t));
+        if (got < (ssize_t)sizeof(txn_posting_t)) return 0;
+        for (size_t i = 0; i < (size_t)got / sizeof(txn_posting_t); i++) {
+            id_index_put(&posting_heads, chunk[i].account_id, postings_covered++);
+        }
+    }
+
+    while (postings_covered < rows) {
+        txn_rec_t tx;
+        if (!txn_read_row(tfd, postings_covered, &tx)) return 0;
+        txn_posting_t post = posting_link(&tx, postings_covered);
+        if (pwrite(pfd, &post, sizeof(txn_posting_t), postings_covered * sizeof(txn_posting_t)) != sizeof(txn_posting_t)) {
+            postings_reset();
+            return 0;
+        }
+        postings_covered++;
+    }
+    return 1;
+}
+
+/*
+ * --- SEGMENT INDEX (txn_segments.db: footers of sealed segments) ---
+ * A segment is sealed when the next row falls on a new UTC day or the segment is full;
+ * its footer is then written to txn_segments.db. The open segment lives in memory only
+ * and is rebuilt from its rows at startup, as are footers lost in a crash.
+ */
+static txn_segment_t seg_open;          // rows == 0 until its first row
+static uint64_t segs_sealed = 0;        // Footers in txn_segments.db
+static uint64_t segs_covered = 0;       // Rows in sealed segments + the open one
+
+static int64_t segment_day(time_t t) {
+    return (int64_t)t / TXN_SEGMENT_SECONDS;
+}
+
+static int segment_seal(int sfd) {
+    off_t pos = (off_t)(segs_sealed * sizeof(txn_segment_t));
+    if (pwrite(sfd, &seg_open, sizeof(seg_open), pos) != sizeof(seg_open)) return 0;
+    segs_sealed++;
+    uint64_t next = seg_open.first_row + seg_open.rows;
+    memset(&seg_open, 0, sizeof(seg_open));
+    seg_open.first_row = next;
+    return 1;
+}
+
+// Add 'row' to the open segment, sealing it first if the row starts a new one
+static int segment_add(int sfd, const txn_rec_t *tx, uint64_t row, int *sealed) {
+    if (seg_open.rows > 0 && (seg_open.rows >= TXN_SEGMENT_MAX_ROWS ||
+                              segment_day(tx->timestamp) != segment_day(seg_open.min_time))) {
+        if (!segment_seal(sfd)) return 0;
+        *sealed = 1;
+    }
+    if (seg_open.rows == 0) {
+        seg_open.first_row = row;
+        seg_open.min_time = seg_open.max_time = tx->timestamp;
+        seg_open.min_txn_id = seg_open.max_txn_id = tx->txn_id;
+    }
+    if (tx->timestamp < seg_open.min_time) seg_open.min_time = tx->timestamp;
+    if (tx->timestamp > seg_open.max_time) seg_open.max_time = tx->timestamp;
+    if (tx->txn_id < seg_open.min_txn_id) seg_open.min_txn_id = tx->txn_id;
+    if (tx->txn_id > seg_open.max_txn_id) seg_open.max_txn_id = tx->txn_id;
+    if (tx->from_account) txn_segment_bloom_add(&seg_open, tx->from_account);
+    if (tx->to_account) txn_segment_bloom_add(&seg_open, tx->to_account);
+    seg_open.rows++;
+    segs_covered = row + 1;
+    return 1;
+}
+
+// Reload the sealed footers and rebuild the open segment up to 'rows' log rows
+// (caller holds DB_TRANSACTIONS exclusively). Footers past the log's end are dropped.
+static int segments_catch_up(uint64_t rows) {
+    int tfd = db_table_fd(DB_TRANSACTIONS);
+    int sfd = db_table_fd(DB_TXN_SEGMENTS);
+    struct stat st;
+    if (tfd < 0 || sfd < 0 || fstat(sfd, &st) != 0) return 0;
+
+    uint64_t sealed = st.st_size / sizeof(txn_segment_t);
+    memset(&seg_open, 0, sizeof(seg_open));
+    while (sealed > 0) {
+        txn_segment_t last;
+        if (pread(sfd, &last, sizeof(last), (off_t)((sealed - 1) * sizeof(last))) != sizeof(last)) return 0;
+        if (last.first_row + last.rows <= rows) {
+            seg_open.first_row = last.first_row + last.rows;
+            break;
+        }
+        sealed--;
+    }
+    if ((off_t)(sealed * sizeof(txn_segment_t)) != st.st_size &&
+        ftruncate(sfd, (off_t)(sealed * sizeof(txn_segment_t))) != 0) {
+        return 0;
+    }
+    segs_sealed = sealed;
+    segs_covered = seg_open.first_row;
+
+    int unused = 0;
+    while (segs_covered < rows) {
+        txn_rec_t tx;
+        if (!txn_read_row(tfd, segs_covered, &tx) || !segment_add(sfd, &tx, segs_covered, &unused)) return 0;
+    }
+    return 1;
+}
+
+// Append a batch at EOF under the exclusive table lock, then make it durable
+static int txn_log_commit(txn_log_req_t *batch, int count) {
+    txn_disk_rec_t rows[TXN_LOG_BATCH_MAX];
+    txn_posting_t posts[TXN_LOG_BATCH_MAX];
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    int pfd = db_table_fd(DB_TXN_POSTINGS);
+    int sfd = db_table_fd(DB_TXN_SEGMENTS);
+    if (fd < 0 || pfd < 0 || sfd < 0 || !log_format_ok) return 0;
+
+    db_table_lock(DB_TRANSACTIONS, LOCK_EXCLUSIVE);
+    uint64_t first_row = txn_row_count(lseek(fd, 0, SEEK_END));
+    off_t end = txn_row_offset(first_row);
+    if (postings_covered != first_row) postings_catch_up(first_row);
+    if (segs_covered != first_row) segments_catch_up(first_row);
+    int sealed = 0;
+
+    txn_log_req_t *req = batch;
+    for (int i = 0; i < count; i++, req = req->next) {
+        req->tx->txn_id = first_row + i + 1;
+        txn_encode(req->tx, log_base_time, &rows[i]);
+    }
+    ssize_t want = (ssize_t)count * sizeof(txn_disk_rec_t);
+    int success = (pwrite(fd, rows, want, end) == want);
+    if (!success) {
+        ftruncate(fd, end);     // Never leave a partial record behind
+    } else if (postings_covered == first_row) {
+        req = batch;
+        for (int i = 0; i < count; i++, req = req->next) {
+            posts[i] = posting_link(req->tx, first_row + i);
+        }
+        off_t post_end = first_row * sizeof(txn_posting_t);
+        if (pwrite(pfd, posts, count * sizeof(txn_posting_t), post_end) == (ssize_t)(count * sizeof(txn_posting_t))) {
+            postings_covered += count;
+        } else {
+            ftruncate(pfd, post_end);   // Rows stay unposted until the next catch-up
+            postings_reset();
+        }
+    }
+    if (success && segs_covered == first_row) {
+        for (int i = 0; i < count && segs_covered == first_row + i; i++) {
+            txn_rec_t tx;
+            txn_decode(&rows[i], &tx);      // As stored (times before the base are clamped)
+            segment_add(sfd, &tx, first_row + i, &sealed);     // On failure the next batch catches up
+        }
+    }
+    db_table_unlock(DB_TRANSACTIONS, LOCK_EXCLUSIVE);
+
+    // Flush outside the table lock so history scans are not held up by the disk
+    if (success && log_policy != TXN_FSYNC_NONE) {
+        success = (log_datasync(fd) == 0 && log_datasync(pfd) == 0 && (!sealed || log_datasync(sfd) == 0));
+    }
+    return success;
+}
+
+// Follow one account's chain from its newest row (shared table lock: appends wait)
+int txn_log_history(uint32_t account_id, int (*visit)(const txn_rec_t *tx, void *data), void *data) {
+    pthread_once(&log_once, txn_log_start);
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    int pfd = db_table_fd(DB_TXN_POSTINGS);
+    if (fd < 0 || pfd < 0) return -1;
+
+    db_table_lock(DB_TRANSACTIONS, LOCK_SHARED);
+    int visited = 0;
+    int64_t row = id_index_get(&posting_heads, account_id);
+    while (row >= 0) {
+        txn_rec_t tx;
+        txn_posting_t post;
+        if (!txn_read_row(fd, row, &tx) ||
+            pread(pfd, &post, sizeof(txn_posting_t), row * sizeof(txn_posting_t)) != sizeof(txn_posting_t)) {
+            break;
+        }
+        visited++;
+        if (!visit(&tx, data) || post.prev >= row) break;   // Chains only ever point backwards
+        row = post.prev;
+    }
+    db_table_unlock(DB_TRANSACTIONS, LOCK_SHARED);
+    return visited;
+}
+
+// Committed rows in transactions.db (-1 if it cannot be read)
+int64_t txn_log_rows(void) {
+    pthread_once(&log_once, txn_log_start);
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    struct stat st;
+    if (fd < 0 || !log_format_ok) return -1;
+    db_table_lock(DB_TRANSACTIONS, LOCK_SHARED);
+    int ok = (fstat(fd, &st) == 0);
+    db_table_unlock(DB_TRANSACTIONS, LOCK_SHARED);
+    return ok ? (int64_t)txn_row_count(st.st_size) : -1;
+}
+
+// Rows are never rewritten once committed, so only the end needs the table lock. They
+// are synced before being read: whatever is built from them survives a crash with them.
+int64_t txn_log_replay(uint64_t from_row, void (*visit)(const txn_rec_t *tx, void *data), void *data) {
+    int64_t end = txn_log_rows();
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    if (end < 0 || (uint64_t)end < from_row) return -1;
+    if ((uint64_t)end == from_row) return 0;
+    if (log_datasync(fd) != 0) return -1;
+
+    txn_disk_rec_t chunk[POSTING_SCAN_CHUNK];
+    uint64_t row = from_row;
+    while (row < (uint64_t)end) {
+        uint64_t want = (uint64_t)end - row;
+        if (want > POSTING_SCAN_CHUNK) want = POSTING_SCAN_CHUNK;
+        size_t got = txn_read_disk_rows(fd, row, want, chunk);
+        if (got == 0) break;    // The caller resumes from here next time
+        for (size_t i = 0; i < got; i++, row++) {
+            txn_rec_t tx;
+            txn_decode(&chunk[i], &tx);
+            visit(&tx, data);
+        }
+    }
+    return (int64_t)(row - from_row);
+}
+
+/*
+ * --- RANGE SCAN (Date range / per-account reads pruned by segment footers) ---
+ * Segments are walked newest first. One whose [min_time, max_time] misses the range, or
+ * whose bloom rules the account out, is skipped without reading a row. The open segment
+ * is checked against its in-memory footer; rows the segment index has not caught up with
+ * have no footer yet and are always read.
+ */
+static txn_range_stats_t range_stats;
+
+typedef struct {
+    time_t from, to;
+    uint32_t account;           // 0 = any account
+    int (*visit)(const txn_rec_t *tx, void *data);
+    void *data;
+    int visited;
+} range_scan_t;
+
+// Rows [first, last) newest first: 1 = go on, 0 = visit() stopped, -1 = read error
+static int range_scan_rows(int fd, uint64_t first, uint64_t last, range_scan_t *scan) {
+    txn_disk_rec_t chunk[POSTING_SCAN_CHUNK];
+    while (last > first) {
+        uint64_t start = last - first > POSTING_SCAN_CHUNK ? last - POSTING_SCAN_CHUNK : first;
+        size_t want = (size_t)(last - start), got = 0;
+        while (got < want) {    // Archive reads stop at block boundaries
+            size_t n = txn_read_disk_rows(fd, start + got, want - got, chunk + got);
+            if (n == 0) return -1;
+            got += n;
+        }
+        for (size_t i = want; i-- > 0;) {
+            txn_rec_t tx;
+            txn_decode(&chunk[i], &tx);
+            if (tx.timestamp < scan->from || tx.timestamp > scan->to) continue;
+            if (scan->account && tx.from_account != scan->account && tx.to_account != scan->account) continue;
+            scan->visited++;
+            if (!scan->visit(&tx, scan->data)) return 0;
+        }
+        last = start;
+    }
+    return 1;
+}
+
+static int range_scan_segment(int fd, const txn_segment_t *seg, range_scan_t *scan) {
+    if (seg->max_time < scan->from || seg->min_time > scan->to ||
+        (scan->account && !txn_segment_may_hold(seg, scan->account))) {
+        range_stats.segments_skipped++;
+        return 1;
+    }
+    range_stats.segments_read++;
+    return range_scan_rows(fd, seg->first_row, seg->first_row + seg->rows, scan);
+}
+
+// Shared table lock: appends, and so seals, wait until the scan is done
+int txn_log_range(uint32_t account_id, time_t from, time_t to,
+                  int (*visit)(const txn_rec_t *tx, void *data), void *data) {
+    pthread_once(&log_once, txn_log_start);
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    int sfd = db_table_fd(DB_TXN_SEGMENTS);
+    if (fd < 0 || sfd < 0 || !log_format_ok) return -1;
+
+    range_scan_t scan = {from, to, account_id, visit, data, 0};
+    struct stat st;
+    db_table_lock(DB_TRANSACTIONS, LOCK_SHARED);
+    int rc = (fstat(fd, &st) == 0) ? 1 : -1;
+    uint64_t end = (rc > 0) ? txn_row_count(st.st_size) : 0;
+    if (rc > 0 && end > segs_covered) rc = range_scan_rows(fd, segs_covered, end, &scan);
+    if (rc > 0 && seg_open.rows > 0) rc = range_scan_segment(fd, &seg_open, &scan);
+    for (uint64_t i = segs_sealed; rc > 0 && i-- > 0;) {
+        txn_segment_t seg;
+        if (pread(sfd, &seg, sizeof(seg), (off_t)(i * sizeof(seg))) != sizeof(seg)) {
+            rc = -1;
+        } else {
+            rc = range_scan_segment(fd, &seg, &scan);
+        }
+    }
+    db_table_unlock(DB_TRANSACTIONS, LOCK_SHARED);
+    range_stats.scans++;
+    return rc < 0 ? -1 : scan.visited;
+}
+
+const txn_range_stats_t *txn_log_range_stats(void) {
+    return &range_stats;
+}
+
+/*
+ * --- ARCHIVER (Server only: cold segments into txn_archive.db) ---
+ * Sealed segments are archived oldest first once their newest row is older than
+ * BANK_ARCHIVE_DAYS. Sealed rows never change, so they are read and compressed without
+ * the table lock; appends carry on meanwhile.
+ */
+static long archive_days = ARCHIVE_DAYS_DEFAULT;
+static long archive_period_sec = ARCHIVE_SEC_DEFAULT;
+static uint64_t archive_seg = 0;        // First footer that may still be unarchived
+static int archive_stop = 0;
+static pthread_mutex_t archive_stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t archive_stop_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t archive_thread;
+static int archive_running = 0;
+
+// Footer of the sealed segment right after the archive; 0 if there is none yet
+static int archive_next_segment(txn_segment_t *seg) {
+    int sfd = db_table_fd(DB_TXN_SEGMENTS);
+    int found = 0;
+    db_table_lock(DB_TRANSACTIONS, LOCK_SHARED);     // Footers below segs_sealed are final
+    for (; !found && archive_seg < segs_sealed; archive_seg++) {
+        if (pread(sfd, seg, sizeof(*seg), (off_t)(archive_seg * sizeof(*seg))) != sizeof(*seg)) break;
+        if (seg->first_row + seg->rows > archived_rows) found = 1;
+    }
+    db_table_unlock(DB_TRANSACTIONS, LOCK_SHARED);
+    if (found) archive_seg--;           // Not archived yet: look at it again next time
+    return found && seg->first_row == archived_rows;
+}
+
+static void archive_pass(void) {
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    time_t cutoff = time(NULL) - (time_t)archive_days * TXN_SEGMENT_SECONDS;
+    txn_segment_t seg;
+    while (!archive_stop && archive_next_segment(&seg) && seg.max_time < cutoff) {
+        txn_disk_rec_t *rows = malloc(seg.rows * sizeof(txn_disk_rec_t));
+        ssize_t want = (ssize_t)(seg.rows * sizeof(txn_disk_rec_t));
+        int ok = rows != NULL && pread(fd, rows, want, txn_row_offset(seg.first_row)) == want &&
+                 txn_archive_append(rows, seg.rows);
+        free(rows);
+        if (!ok) {
+            fprintf(stderr, "txn archive: could not archive rows %llu-%llu\n", (unsigned long long)seg.first_row + 1,
+                    (unsigned long long)(seg.first_row + seg.rows));
+            return;                     // Try again next period
+        }
+        pthread_rwlock_wrlock(&archive_boundary_lock);
+        archived_rows = seg.first_row + seg.rows;
+        pthread_rwlock_unlock(&archive_boundary_lock);
+        // The whole archived prefix: disk blocks straddling two segments are freed too
+        txn_archive_release_hot(fd, txn_row_offset(0), (off_t)(archived_rows * TXN_DISK_REC_SIZE));
+    }
+}
+
+static void *txn_archiver_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&archive_stop_lock);
+    while (!archive_stop) {
+        pthread_mutex_unlock(&archive_stop_lock);
+        archive_pass();
+        pthread_mutex_lock(&archive_stop_lock);
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += archive_period_sec;
+        while (!archive_stop && pthread_cond_timedwait(&archive_stop_cond, &archive_stop_lock, &wake) != ETIMEDOUT);
+    }
+    pthread_mutex_unlock(&archive_stop_lock);
+    return NULL;
+}
+
+int txn_archiver_start(void) {
+    const char *days = getenv(ARCHIVE_DAYS_ENV);
+    if (days != NULL && *days != '\0') archive_days = atol(days);
+    const char *period = getenv(ARCHIVE_SEC_ENV);
+    if (period != NULL && atol(period) > 0) archive_period_sec = atol(period);
+    if (archive_days < 0 || !log_format_ok) return 0;      // Archiving turned off
+    if (pthread_create(&archive_thread, NULL, txn_archiver_main, NULL) != 0) return -1;
+    archive_running = 1;
+    return 0;
+}
+
+void txn_archiver_stop(void) {
+    if (!archive_running) return;
+    pthread_mutex_lock(&archive_stop_lock);
+    archive_stop = 1;
+    pthread_cond_signal(&archive_stop_cond);
+    pthread_mutex_unlock(&archive_stop_lock);
+    pthread_join(archive_thread, NULL);
+    archive_running = 0;
+}
+
+static void *txn_log_writer(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&log_lock);
+    for (;;) {
+        while (log_head == NULL) pthread_cond_wait(&log_work, &log_lock);
+
+        // Commit window: let concurrent transactions join this batch
+        if (log_policy != TXN_FSYNC_TXN && log_window_us > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += log_window_us / 1000000;
+            deadline.tv_nsec += (log_window_us % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            while (log_pending < log_batch_max &&
+                   pthread_cond_timedwait(&log_work, &log_lock, &deadline) != ETIMEDOUT);
+        }
+
+        // Detach whole groups, up to log_batch_max rows (the first group always fits)
+        txn_log_req_t *batch = log_head, *next = log_head;
+        int count = 0;
+        while (next != NULL && (count == 0 || count + next->group <= log_batch_max)) {
+            for (int i = next->group; i > 0; i--, count++) next = next->next;
+        }
+        log_head = next;
+        if (log_head == NULL) log_tail = NULL;
+        log_pending -= count;
+        pthread_mutex_unlock(&log_lock);
+
+        int success = txn_log_commit(batch, count);
+
+        pthread_mutex_lock(&log_lock);
+        for (int i = 0; i < count; i++) {
+            txn_log_req_t *next = batch->next;  // Caller's frame is gone once 'done' is set
+            batch->done = success ? 1 : -1;
+            batch = next;
+        }
+        pthread_cond_broadcast(&log_done);
+    }
+    return NULL;
+}
+
+// One-time setup (pthread_once): read the policy and start the writer thread
+static void txn_log_start(void) {
+    const char *policy = getenv(TXN_FSYNC_ENV);
+    if (policy == NULL || strcmp(policy, "group") == 0) {
+        log_policy = TXN_FSYNC_GROUP;
+    } else if (strcmp(policy, "txn") == 0) {
+        log_policy = TXN_FSYNC_TXN;
+    } else if (strcmp(policy, "none") == 0) {
+        log_policy = TXN_FSYNC_NONE;
+    } else {
+        fprintf(stderr, "Unknown %s '%s', using group commit\n", TXN_FSYNC_ENV, policy);
+    }
+    const char *window = getenv(TXN_GROUP_WINDOW_ENV);
+    if (window != NULL) log_window_us = atol(window);
+    if (log_policy == TXN_FSYNC_TXN) log_batch_max = 1;
+
+    // Check the format, then post any rows the index has not seen (first run, or a crash mid-commit)
+    int fd = db_table_fd(DB_TRANSACTIONS);
+    if (fd >= 0) {
+        db_table_lock(DB_TRANSACTIONS, LOCK_EXCLUSIVE);
+        log_format_ok = txn_file_open_format(fd);
+        if (log_format_ok && txn_archive_open(1) == 0) {
+            // Archived rows come from the archive; release their hot copies again in case a
+            // crash came between the two
+            archived_rows = txn_archive_rows();
+            if (archived_rows > 0) txn_archive_release_hot(fd, txn_row_offset(0), (off_t)(archived_rows * TXN_DISK_REC_SIZE));
+        } else if (log_format_ok) {
+            fprintf(stderr, "Failed to open %s\n", TXN_ARCHIVE_INDEX_FILE);
+            log_format_ok = 0;
+        }
+        if (!log_format_ok) {
+            fprintf(stderr, "%s is not in the v%d format; start the server once to convert it\n",
+                    TRANSACTIONS_DB_FILE, TXN_FILE_VERSION);
+        } else {
+            uint64_t rows = txn_row_count(lseek(fd, 0, SEEK_END));
+            if (!postings_catch_up(rows) || !segments_catch_up(rows)) {
+                fprintf(stderr, "Failed to index %s\n", TRANSACTIONS_DB_FILE);
+            }
+        }
+        db_table_unlock(DB_TRANSACTIONS, LOCK_EXCLUSIVE);
+    }
+
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, txn_log_writer, NULL) == 0) {
+        pthread_detach(writer);
+        log_writer_running = 1;
+    } else {
+        perror("txn log writer");
+    }
+}
+
+int init_txn_log(void) {
+    pthread_once(&log_once, txn_log_start);
+    return log_writer_running ? 0 : -1;
+}
+
+int txn_log_append(txn_rec_t *tx) {
+    return txn_log_append_all(tx, 1);
+}
+
+int txn_log_append_all(txn_rec_t *txs, int count) {
+    pthread_once(&log_once, txn_log_start);
+    if (count < 1 || count > TXN_LOG_BATCH_MAX) return 0;
+    txn_log_req_t reqs[count];
+    for (int i = 0; i < count; i++) {
+        reqs[i].tx = &txs[i];
+        reqs[i].group = (i == 0) ? count : 0;
+        reqs[i].done = 0;
+        reqs[i].next = (i + 1 < count) ? &reqs[i + 1] : NULL;
+    }
+    if (!log_writer_running) {
+        return txn_log_commit(reqs, count);    // No writer thread: commit inline
+    }
+
+    pthread_mutex_lock(&log_lock);
+    if (log_tail) log_tail->next = &reqs[0];
+    else log_head = &reqs[0];
+    log_tail = &reqs[count - 1];
+    log_pending += count;
+    pthread_cond_signal(&log_work);
+    while (reqs[0].done == 0) pthread_cond_wait(&log_done, &log_lock);     // The group shares one batch
+    pthread_mutex_unlock(&log_lock);
+    return reqs[0].done == 1;
+}
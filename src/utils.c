@@ -1,5 +1,15 @@
 #include "utils.h"
+#include "db_index.h"
+#include "table.h"
+#include "txn_log.h"
+#include "redo_log.h"
 #include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
 #include <unistd.h> // For crypt() on macOS
 
 /*
@@ -7,30 +17,45 @@
  * Provides atomic, file-locked operations crucial for data integrity.
  */
 
-// Generic record locking (internal use)
-static int lock_record(int fd, long offset, size_t record_size);
-static int unlock_record(int fd, long offset, size_t record_size);
+// Record locking (internal use)
+static void db_record_lock(db_table_id_t table, uint64_t recordId, lock_mode_t mode);
+static void db_record_unlock(db_table_id_t table, uint64_t recordId, lock_mode_t mode);
 
-// Finders (internal use)
-static long find_user_offset(uint32_t userId);
-static long find_account_offset(uint32_t userId);
-static long find_loan_offset(uint64_t loanId);
+// Tables and finders (internal use)
+static record_table_t users_table;
+static record_table_t loans_table;
+static record_table_t feedback_table;
+_Static_assert(sizeof(user_rec_t) <= TABLE_MAX_REC_SIZE && sizeof(loan_rec_t) <= TABLE_MAX_REC_SIZE &&
+               sizeof(feedback_rec_t) <= TABLE_MAX_REC_SIZE, "record too large for the table engine");
+static uint32_t find_username_owner(const char *username);
+static long account_slot_offset(uint32_t accountId);
 
 /*
  * --- FILE LOCKING (fcntl System Call) ---
+ * Only coordinates with other processes (bootstrap, inspector); threads of the
+ * server exclude each other through the lock manager.
  */
 
-// Acquire exclusive lock on ENTIRE file (Used for search/append)
-int lock_file(int fd) {
+static int lock_file_mode(int fd, short type) {
     struct flock lock;
     memset(&lock, 0, sizeof(lock));
-    lock.l_type = F_WRLCK;
+    lock.l_type = type;
     lock.l_whence = SEEK_SET;
     lock.l_start = 0;
     lock.l_len = 0; // 0 means to lock to EOF
     return fcntl(fd, F_SETLKW, &lock);
 }
 
+// Acquire exclusive lock on ENTIRE file (Used for rewrites/appends)
+int lock_file(int fd) {
+    return lock_file_mode(fd, F_WRLCK);
+}
+
+// Acquire shared lock on ENTIRE file (Used for read-only passes; excludes writers only)
+int lock_file_shared(int fd) {
+    return lock_file_mode(fd, F_RDLCK);
+}
+
 // Unlock ENTIRE file
 int unlock_file(int fd) {
     struct flock lock;
@@ -42,26 +67,323 @@ int unlock_file(int fd) {
     return fcntl(fd, F_SETLKW, &lock);
 }
 
-// Lock a single record for exclusive access (RECORD LOCKING)
-static int lock_record(int fd, long offset, size_t record_size) {
-    struct flock lock;
-    memset(&lock, 0, sizeof(lock));
-    lock.l_type = F_WRLCK; // Exclusive Write Lock
-    lock.l_whence = SEEK_SET;
-    lock.l_start = offset;
-    lock.l_len = record_size; // Lock ONLY the size of one record
-    return fcntl(fd, F_SETLKW, &lock); 
+/*
+ * --- TABLE HANDLES (One shared descriptor per .db file) ---
+ * Each db file is opened once per process and shared by every thread via pread/pwrite.
+ * fcntl locks belong to the process (and are all dropped when *any* descriptor on the
+ * file is closed), so threads lock through the lock manager, keyed by (table, record
+ * id). Exclusive table locks also take the fcntl file lock for other processes;
+ * record locks and shared scans stay in-process and cost no system call.
+ */
+typedef struct {
+    const char *path;
+    int fd;
+    // Process-wide holders of the fcntl lock (see db_file_lock)
+    pthread_mutex_t flock_mutex;
+    pthread_cond_t flock_cond;
+    int flock_readers;
+    int flock_writer;
+    int flock_writers_waiting;
+} db_table_t;
+
+static db_table_t db_tables[DB_TABLE_COUNT] = {
+    [DB_USERS]        = { USERS_DB_FILE, -1 },
+    [DB_ACCOUNTS]     = { ACCOUNTS_DB_FILE, -1 },
+    [DB_TRANSACTIONS] = { TRANSACTIONS_DB_FILE, -1 },
+    [DB_LOANS]        = { LOANS_DB_FILE, -1 },
+    [DB_FEEDBACK]     = { FEEDBACK_DB_FILE, -1 },
+    [DB_TXN_POSTINGS] = { TXN_POSTINGS_DB_FILE, -1 },
+    [DB_TXN_SEGMENTS] = { TXN_SEGMENTS_DB_FILE, -1 },
+    [DB_FEEDBACK_WATERMARK] = { FEEDBACK_WATERMARK_FILE, -1 },
+    [DB_REDO]         = { REDO_DB_FILE, -1 },
+};
+static pthread_once_t db_tables_once = PTHREAD_ONCE_INIT;
+
+static void db_tables_open(void) {
+    for (int t = 0; t < DB_TABLE_COUNT; t++) {
+        pthread_mutex_init(&db_tables[t].flock_mutex, NULL);
+        pthread_cond_init(&db_tables[t].flock_cond, NULL);
+        db_tables[t].fd = open(db_tables[t].path, O_RDWR | O_CREAT, 0666);
+        if (db_tables[t].fd < 0) perror(db_tables[t].path);
+    }
 }
 
-// Unlock a single record
-static int unlock_record(int fd, long offset, size_t record_size) {
-    struct flock lock;
-    memset(&lock, 0, sizeof(lock));
-    lock.l_type = F_UNLCK; 
-    lock.l_whence = SEEK_SET;
-    lock.l_start = offset;
-    lock.l_len = record_size; 
-    return fcntl(fd, F_SETLKW, &lock);
+// Open every table once per process (called from server_init; lazily elsewhere)
+int init_db_tables(void) {
+    pthread_once(&db_tables_once, db_tables_open);
+    for (int t = 0; t < DB_TABLE_COUNT; t++) {
+        if (db_tables[t].fd < 0) return -1;
+    }
+    return 0;
+}
+
+// Shared descriptor for a table (never close it)
+int db_table_fd(db_table_id_t table) {
+    pthread_once(&db_tables_once, db_tables_open);
+    return db_tables[table].fd;
+}
+
+/*
+ * --- PROCESS FILE LOCKS (fcntl, shared by the server's threads) ---
+ * A second fcntl lock from another thread silently converts the process's lock, and one
+ * F_UNLCK drops it for every thread. So threads go through a per-table count: the first
+ * shared holder takes F_RDLCK and the last one releases it, while an exclusive holder
+ * waits for them to drain and holds F_WRLCK alone. Waiting writers block new readers.
+ */
+int db_file_lock(db_table_id_t table, lock_mode_t mode) {
+    db_table_t *t = &db_tables[table];
+    int fd = db_table_fd(table);
+    int rc = 0;
+    pthread_mutex_lock(&t->flock_mutex);
+    if (mode == LOCK_EXCLUSIVE) {
+        t->flock_writers_waiting++;
+        while (t->flock_writer || t->flock_readers > 0) pthread_cond_wait(&t->flock_cond, &t->flock_mutex);
+        t->flock_writers_waiting--;
+        t->flock_writer = 1;
+        rc = lock_file(fd);
+    } else {
+        while (t->flock_writer || t->flock_writers_waiting > 0) pthread_cond_wait(&t->flock_cond, &t->flock_mutex);
+        if (t->flock_readers++ == 0) rc = lock_file_shared(fd);
+    }
+    pthread_mutex_unlock(&t->flock_mutex);
+    return rc;
+}
+
+int db_file_unlock(db_table_id_t table, lock_mode_t mode) {
+    db_table_t *t = &db_tables[table];
+    int rc = 0;
+    pthread_mutex_lock(&t->flock_mutex);
+    if (mode == LOCK_EXCLUSIVE) {
+        rc = unlock_file(t->fd);
+        t->flock_writer = 0;
+    } else if (--t->flock_readers == 0) {
+        rc = unlock_file(t->fd);
+    }
+    pthread_cond_broadcast(&t->flock_cond);
+    pthread_mutex_unlock(&t->flock_mutex);
+    return rc;
+}
+
+// Whole-table lock (shared for scans; exclusive for appends and batch updates)
+int db_table_lock(db_table_id_t table, lock_mode_t mode) {
+    lm_lock_table(table, mode);
+    return (mode == LOCK_EXCLUSIVE) ? db_file_lock(table, LOCK_EXCLUSIVE) : 0;
+}
+
+int db_table_unlock(db_table_id_t table, lock_mode_t mode) {
+    int rc = (mode == LOCK_EXCLUSIVE) ? db_file_unlock(table, LOCK_EXCLUSIVE) : 0;
+    lm_unlock_table(table, mode);
+    return rc;
+}
+
+// Record lock (in-process only: readers share, writers exclude each other and whole-table ops)
+static void db_record_lock(db_table_id_t table, uint64_t recordId, lock_mode_t mode) {
+    lm_lock_record(table, recordId, mode);
+}
+
+static void db_record_unlock(db_table_id_t table, uint64_t recordId, lock_mode_t mode) {
+    lm_unlock_record(table, recordId, mode);
+}
+
+/*
+ * --- USER TABLE (user_id -> row; username/email/phone -> owner user_id) ---
+ * The unique-key indexes hang off the table engine's hooks, so they are built in the
+ * same pass as the primary index and kept current by every append and update; logins
+ * and uniqueness checks never scan users.db. They share the table's index lock.
+ * A negative owner (a new_user_ticket) marks a key reserved by check_uniqueness for a user
+ * not yet written; each creator has its own ticket, so it can only ever clear its own.
+ */
+static str_index_t username_index;
+static str_index_t email_index;
+static str_index_t phone_index;
+
+static uint64_t user_key(const void *rec) {
+    return ((const user_rec_t *)rec)->user_id;
+}
+
+/*
+ * Usernames also go into a bloom filter that logins probe without any lock. A full
+ * filter is swapped for a bigger one under the index write lock and the old one is kept
+ * (retired_filters): a login may still be probing the one it loaded.
+ */
+static _Atomic(bloom_filter_t *) username_filter = NULL;
+static bloom_filter_t **retired_filters = NULL;
+static size_t retired_filter_count = 0;
+static username_filter_stats_t uf_stats;
+
+// Fresh filter over every owned username, sized for twice as many (caller holds the index write lock)
+static int username_filter_rebuild(void) {
+    bloom_filter_t *f = malloc(sizeof(bloom_filter_t));
+    bloom_filter_t **retired = realloc(retired_filters, (retired_filter_count + 1) * sizeof(bloom_filter_t *));
+    if (retired != NULL) retired_filters = retired;
+    if (f == NULL || retired == NULL || !bloom_init(f, username_index.count * 2)) {
+        free(f);
+        return 0;
+    }
+    for (size_t i = 0; i < username_index.capacity; i++) {
+        const str_index_slot_t *slot = &username_index.slots[i];
+        if (slot->key != NULL && slot->key != STR_INDEX_TOMBSTONE && slot->value > 0) bloom_add(f, slot->key);
+    }
+    bloom_filter_t *old = atomic_exchange_explicit(&username_filter, f, memory_order_acq_rel);
+    if (old != NULL) retired_filters[retired_filter_count++] = old;
+    return 1;
+}
+
+// Index hook: a row was indexed; turns its reserved keys into owned ones
+static void user_keys_insert(const void *rec, uint64_t row) {
+    const user_rec_t *user = rec;
+    (void)row;
+    str_index_put(&username_index, user->username, user->user_id);
+    bloom_filter_t *f = atomic_load_explicit(&username_filter, memory_order_relaxed);
+    if (f != NULL) {
+        // A full filter keeps the old one serving (rate creeping up) if the rebuild fails
+        if (f->count < f->capacity || !username_filter_rebuild()) bloom_add(f, user->username);
+    }
+    str_index_put(&email_index, user->email, user->user_id);
+    str_index_put(&phone_index, user->phone, user->user_id);
+}
+
+// Drop 'key' from a unique set only if 'owner' holds it (caller holds the index write lock)
+static void unique_key_release(str_index_t *set, const char *key, int64_t owner) {
+    if (key != NULL && str_index_get(set, key) == owner) {
+        str_index_del(set, key);
+    }
+}
+
+// Index hook: after an in-place update, move email/phone ownership from the old values to the new
+static void user_keys_replace(const void *old_rec, const void *new_rec) {
+    const user_rec_t *old = old_rec, *updated = new_rec;
+    if (strcmp(old->email, updated->email) != 0) {
+        unique_key_release(&email_index, old->email, old->user_id);
+        str_index_put(&email_index, updated->email, updated->user_id);
+    }
+    if (strcmp(old->phone, updated->phone) != 0) {
+        unique_key_release(&phone_index, old->phone, old->user_id);
+        str_index_put(&phone_index, updated->phone, updated->user_id);
+    }
+}
+
+// Index hook: the update was not written, so drop the keys its modifier reserved
+static void user_keys_unreserve(const void *old_rec, const void *new_rec) {
+    const user_rec_t *old = old_rec, *attempted = new_rec;
+    if (strcmp(old->email, attempted->email) != 0) unique_key_release(&email_index, attempted->email, old->user_id);
+    if (strcmp(old->phone, attempted->phone) != 0) unique_key_release(&phone_index, attempted->phone, old->user_id);
+}
+
+static record_table_t users_table = {
+    .table = DB_USERS,
+    .rec_size = sizeof(user_rec_t),
+    .key_of = user_key,
+    .pooled = 1,
+    .cached = 1,
+    .hooks = { .on_insert = user_keys_insert, .on_update = user_keys_replace, .on_update_failed = user_keys_unreserve },
+    .index_lock = PTHREAD_RWLOCK_INITIALIZER,
+    .versions_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+// Username probe (0 if unknown). A name the filter rules out is rejected unless users.db
+// has grown past the index (a user added by another process, e.g. bootstrap): then the
+// new rows are indexed, which also adds them to the filter, and the index is probed.
+// Otherwise an index miss re-checks users.db like any table lookup.
+static uint32_t find_username_owner(const char *username) {
+    bloom_filter_t *f = atomic_load_explicit(&username_filter, memory_order_acquire);
+    atomic_fetch_add_explicit(&uf_stats.lookups, 1, memory_order_relaxed);
+    int ruled_out = (f != NULL && !bloom_may_contain(f, username));
+    if (ruled_out && !(table_has_unindexed(&users_table) && table_catch_up(&users_table))) {
+        atomic_fetch_add_explicit(&uf_stats.rejected, 1, memory_order_relaxed);
+        return 0;
+    }
+    table_index_lock(&users_table, LOCK_SHARED);
+    int64_t owner = str_index_get(&username_index, username);
+    table_index_unlock(&users_table);
+    if (owner < 0 && !ruled_out && table_catch_up(&users_table)) {
+        table_index_lock(&users_table, LOCK_SHARED);
+        owner = str_index_get(&username_index, username);
+        table_index_unlock(&users_table);
+    }
+    if (owner <= 0 && ruled_out) atomic_fetch_add_explicit(&uf_stats.rejected, 1, memory_order_relaxed);
+    else if (owner <= 0 && f != NULL) atomic_fetch_add_explicit(&uf_stats.false_positives, 1, memory_order_relaxed);
+    return (owner > 0) ? (uint32_t)owner : 0;
+}
+
+const username_filter_stats_t *username_filter_stats(void) {
+    return &uf_stats;
+}
+
+double username_filter_expected_rate(void) {
+    bloom_filter_t *f = atomic_load_explicit(&username_filter, memory_order_acquire);
+    return f != NULL ? bloom_false_positive_rate(f) : 0.0;
+}
+
+// Undo a check_uniqueness reservation that was never written (NULL keys are skipped)
+void release_user_keys(const char *username, const char *email, const char *phone, int64_t owner) {
+    table_index_lock(&users_table, LOCK_EXCLUSIVE);
+    unique_key_release(&username_index, username, owner);
+    unique_key_release(&email_index, email, owner);
+    unique_key_release(&phone_index, phone, owner);
+    table_index_unlock(&users_table);
+}
+
+/*
+ * --- LOAN TABLE (loan_id -> row; status / assigned_to / user_id -> loan ids) ---
+ * The secondary lists are maintained by the engine's hooks, so the loan queues cost
+ * time proportional to their results. Readers copy a list and begin a snapshot under
+ * the index read lock, then read the loans as of that snapshot without holding it.
+ */
+static id_multi_index_t loans_by_status;
+static id_multi_index_t loans_by_assignee;
+static id_multi_index_t loans_by_applicant;
+
+static id_multi_index_t *loan_index_for(loan_index_field_t field) {
+    switch (field) {
+        case LOAN_BY_STATUS:    return &loans_by_status;
+        case LOAN_BY_ASSIGNEE:  return &loans_by_assignee;
+        case LOAN_BY_APPLICANT: return &loans_by_applicant;
+    }
+    return NULL;
+}
+
+static uint64_t loan_key(const void *rec) {
+    return ((const loan_rec_t *)rec)->loan_id;
+}
+
+static void loan_index_add(const void *rec, uint64_t row) {
+    const loan_rec_t *loan = rec;
+    (void)row;
+    id_multi_add(&loans_by_status, loan->status, loan->loan_id);
+    id_multi_add(&loans_by_assignee, loan->assigned_to, loan->loan_id);
+    id_multi_add(&loans_by_applicant, loan->user_id, loan->loan_id);
+}
+
+// Move a rewritten loan between secondary lists
+static void loan_index_replace(const void *old_rec, const void *new_rec) {
+    const loan_rec_t *old = old_rec, *updated = new_rec;
+    id_multi_del(&loans_by_status, old->status, old->loan_id);
+    id_multi_del(&loans_by_assignee, old->assigned_to, old->loan_id);
+    id_multi_del(&loans_by_applicant, old->user_id, old->loan_id);
+    loan_index_add(updated, 0);
+}
+
+static record_table_t loans_table = {
+    .table = DB_LOANS,
+    .rec_size = sizeof(loan_rec_t),
+    .key_of = loan_key,
+    .pooled = 1,
+    .hooks = { .on_insert = loan_index_add, .on_update = loan_index_replace },
+    .index_lock = PTHREAD_RWLOCK_INITIALIZER,
+    .versions_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+// Build all in-memory indexes up front (called from server_init)
+int init_db_indexes(void) {
+    if (!table_build(&users_table) || !table_build(&loans_table) || !table_build(&feedback_table)) {
+        return -1;
+    }
+    table_index_lock(&users_table, LOCK_EXCLUSIVE);
+    int filtered = username_filter_rebuild();
+    table_index_unlock(&users_table);
+    if (!filtered) return -1;
+    return 0;
 }
 
 /*
@@ -87,488 +409,1034 @@ int verify_password(const char *password, const char *hash) {
     return (strcmp(verified_hash, hash) == 0);
 }
 
-// User Login Function (Uses full-file lock for safe read)
+// User Login Function (Username index probe + single record read)
 int login_user(const char *username, const char *password, int *userId, char *role, size_t role_sz, char *fname_out, size_t fname_sz) {
-    int fd = open(USERS_DB_FILE, O_RDONLY);
-    if (fd < 0) return 0;
-    
-    lock_file(fd);
+    fname_out[0] = '\0';
+    uint32_t owner = find_username_owner(username);
     user_rec_t user;
+    if (owner == 0 || !read_user(owner, &user) || strcmp(user.username, username) != 0) return 0;
+
     int found = 0; 
-    fname_out[0] = '\0';
+    if (verify_password(password, user.password_hash)) {
+        
+        account_rec_t acc;
+        int account_found = read_account(user.user_id, &acc);
 
-    while (read(fd, &user, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-        if (strcmp(user.username, username) == 0) {
+        if (user.active == STATUS_INACTIVE || (account_found && acc.active == STATUS_INACTIVE)) {
+            found = 2; // Inactive
+        } else {
+            *userId = user.user_id;
             
-            if (verify_password(password, user.password_hash)) {
-                
-                account_rec_t acc;
-                int account_found = read_account(user.user_id, &acc);
-
-                if (user.active == STATUS_INACTIVE || (account_found && acc.active == STATUS_INACTIVE)) {
-                    found = 2; // Inactive
-                } else {
-                    *userId = user.user_id;
-                    
-                    strncpy(fname_out, user.first_name, fname_sz - 1);
-                    if (user.role == ROLE_CUSTOMER) strncpy(role, "customer", role_sz);
-                    else if (user.role == ROLE_EMPLOYEE) strncpy(role, "employee", role_sz);
-                    else if (user.role == ROLE_MANAGER) strncpy(role, "manager", role_sz);
-                    else if (user.role == ROLE_ADMIN) strncpy(role, "admin", role_sz);
-                    else strncpy(role, "unknown", role_sz);
-
-                    found = 1; 
-                }
-            }
-            break; 
+            strncpy(fname_out, user.first_name, fname_sz - 1);
+            if (user.role == ROLE_CUSTOMER) strncpy(role, "customer", role_sz);
+            else if (user.role == ROLE_EMPLOYEE) strncpy(role, "employee", role_sz);
+            else if (user.role == ROLE_MANAGER) strncpy(role, "manager", role_sz);
+            else if (user.role == ROLE_ADMIN) strncpy(role, "admin", role_sz);
+            else strncpy(role, "unknown", role_sz);
+
+            found = 1; 
         }
     }
-    unlock_file(fd);
-    close(fd);
     return found;
 }
 
 /*
  * --- ATOMIC R-M-W HANDLERS (Core Concurrency Primitives) ---
  */
-// Offset Finder for Users (Full-file lock for consistent search)
-static long find_user_offset(uint32_t userId) {
-    int fd = open(USERS_DB_FILE, O_RDONLY);
-    if (fd < 0) return -1;
-    lock_file(fd); 
-    user_rec_t tmp;
-    long current_offset = 0;
-    long found_offset = -1;
-    while (read(fd, &tmp, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-        if (tmp.user_id == userId) {
-            found_offset = current_offset;
-            break; 
-        }
-        current_offset += sizeof(user_rec_t); 
-    }
-    unlock_file(fd);
-    close(fd);
-    return found_offset;
+// Typed modifiers are called through the engine's untyped one
+typedef struct {
+    int (*user)(user_rec_t *user, void *data);
+    int (*loan)(loan_rec_t *loan, void *data);
+    void *data;
+} typed_modifier_t;
+
+static int call_user_modifier(void *rec, void *data) {
+    typed_modifier_t *m = data;
+    return m->user((user_rec_t *)rec, m->data);
+}
+
+static int call_loan_modifier(void *rec, void *data) {
+    typed_modifier_t *m = data;
+    return m->loan((loan_rec_t *)rec, m->data);
 }
 
 // Atomic R-M-W for users.db (Record-level lock guarantees isolation)
+// Email/phone keys reserved by the modifier (check_uniqueness) are committed or released by the hooks.
 int atomic_update_user(uint32_t userId, int (*modifier)(user_rec_t *user, void *data), void *modifier_data) {
-    long offset = find_user_offset(userId);
-    if (offset < 0) return 0; // Not found
-    
-    int fd = open(USERS_DB_FILE, O_RDWR);
-    if (fd < 0) return 0;
+    typed_modifier_t m = { .user = modifier, .data = modifier_data };
+    return table_update(&users_table, userId, call_user_modifier, &m);
+}
+
+/*
+ * --- ACCOUNT SLOT LAYOUT (accounts.db is direct-addressed) ---
+ * account_id == user_id and IDs are dense from USER_ID_BASE, so record N lives at
+ * (N - USER_ID_BASE) * sizeof(account_rec_t). Slots without an account (staff IDs,
+ * holes) hold account_id == ACCOUNT_SLOT_EMPTY.
+ */
+static long account_slot_offset(uint32_t accountId) {
+    if (accountId < USER_ID_BASE) return -1;
+    return (long)(accountId - USER_ID_BASE) * (long)sizeof(account_rec_t);
+}
+
+// One-time rewrite of an append-ordered accounts.db into slot order
+static int migrate_accounts_layout(void) {
+    int fd = open(ACCOUNTS_DB_FILE, O_RDWR);
+    if (fd < 0) return 0;       // No accounts yet: nothing to migrate
+    lock_file(fd);
 
-    if (lock_record(fd, offset, sizeof(user_rec_t)) != 0) {
-        close(fd); return 0; // Lock failed
+    account_rec_t tmp;
+    off_t pos = 0;
+    int slotted = 1;
+    while (pread(fd, &tmp, sizeof(account_rec_t), pos) == sizeof(account_rec_t)) {
+        if (tmp.account_id != ACCOUNT_SLOT_EMPTY && account_slot_offset(tmp.account_id) != pos) {
+            slotted = 0;
+            break;
+        }
+        pos += sizeof(account_rec_t);
     }
 
-    int success = 0;
-    user_rec_t tmp;
-    
-    lseek(fd, offset, SEEK_SET); 
-    if (read(fd, &tmp, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-        if (modifier(&tmp, modifier_data)) {
-            lseek(fd, offset, SEEK_SET); 
-            if (write(fd, &tmp, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-                success = 1;
+    int rc = 0;
+    if (!slotted) {
+        const char *tmp_path = ACCOUNTS_DB_FILE ".migrating";
+        int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (out < 0) {
+            rc = -1;
+        } else {
+            pos = 0;
+            while (rc == 0 && pread(fd, &tmp, sizeof(account_rec_t), pos) == sizeof(account_rec_t)) {
+                long slot = account_slot_offset(tmp.account_id);
+                if (tmp.account_id != ACCOUNT_SLOT_EMPTY && slot >= 0 &&
+                    pwrite(out, &tmp, sizeof(account_rec_t), slot) != sizeof(account_rec_t)) {
+                    rc = -1;
+                }
+                pos += sizeof(account_rec_t);
+            }
+            if (rc == 0 && fsync(out) == 0 && rename(tmp_path, ACCOUNTS_DB_FILE) == 0) {
+                printf("Migrated %s to slot layout.\n", ACCOUNTS_DB_FILE);
+            } else {
+                rc = -1;
+                unlink(tmp_path);
             }
+            close(out);
         }
     }
+    unlock_file(fd);
+    close(fd);
+    return rc;
+}
 
-    unlock_record(fd, offset, sizeof(user_rec_t));
+/*
+ * --- SCHEMA VERSION + MONEY MIGRATION (meta.db) ---
+ * Schema 1 stored balances and loan amounts as double; schema 2 stores money_t minor
+ * units in the same record layout, so only meta.db tells the two apart. The upgrade
+ * writes converted copies first and then meta.db.migrating as its commit point; the
+ * renames after that are simply redone on the next start if they were interrupted.
+ * Schema 3 gives the padding of account and loan records a meaning (the redo stamp), so
+ * it is zeroed in place before meta.db says 3; an interrupted pass is simply redone.
+ */
+#define META_MIGRATING_FILE META_DB_FILE ".migrating"
+#define ACCOUNTS_MONEY_FILE ACCOUNTS_DB_FILE ".money"
+#define LOANS_MONEY_FILE LOANS_DB_FILE ".money"
+
+typedef struct {
+    uint32_t account_id;
+    uint32_t user_id;
+    double balance;
+    status_t active;
+} account_v1_rec_t;
+typedef struct {
+    uint64_t loan_id;
+    uint32_t user_id;
+    double amount;
+    loan_status_t status;
+    uint32_t assigned_to;
+    time_t applied_at;
+    time_t processed_at;
+    char remarks[256];
+} loan_v1_rec_t;
+
+_Static_assert(sizeof(account_v1_rec_t) == sizeof(account_rec_t), "account layout changed");
+_Static_assert(sizeof(loan_v1_rec_t) == sizeof(loan_rec_t), "loan layout changed");
+
+static void convert_account_v1(const void *in, void *out) {
+    const account_v1_rec_t *old = in;
+    account_rec_t *acc = out;
+    memset(acc, 0, sizeof(*acc));
+    acc->account_id = old->account_id;
+    acc->user_id = old->user_id;
+    acc->balance = money_from_double(old->balance);
+    acc->active = old->active;
+}
+
+static void convert_loan_v1(const void *in, void *out) {
+    const loan_v1_rec_t *old = in;
+    loan_rec_t *loan = out;
+    memset(loan, 0, sizeof(*loan));
+    loan->loan_id = old->loan_id;
+    loan->user_id = old->user_id;
+    loan->amount = money_from_double(old->amount);
+    loan->status = old->status;
+    loan->assigned_to = old->assigned_to;
+    loan->applied_at = old->applied_at;
+    loan->processed_at = old->processed_at;
+    memcpy(loan->remarks, old->remarks, sizeof(loan->remarks));
+}
+
+// Write a converted copy of 'src' to 'dst' (a missing 'src' is left alone)
+static int convert_db_file(const char *src, const char *dst, size_t rec_sz, void (*convert)(const void *in, void *out)) {
+    int fd = open(src, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        close(fd);
+        return -1;
+    }
+    lock_file_shared(fd);
+    char in_rec[512], out_rec[512];
+    int rc = 0;
+    for (off_t pos = 0; rc == 0 && pread(fd, in_rec, rec_sz, pos) == (ssize_t)rec_sz; pos += rec_sz) {
+        convert(in_rec, out_rec);
+        if (pwrite(out, out_rec, rec_sz, pos) != (ssize_t)rec_sz) rc = -1;
+    }
+    if (rc == 0 && fsync(out) != 0) rc = -1;
+    unlock_file(fd);
+    close(out);
     close(fd);
-    return success;
+    return rc;
 }
 
-// Offset Finder for Accounts
-static long find_account_offset(uint32_t userId) {
-    int fd = open(ACCOUNTS_DB_FILE, O_RDONLY);
+static int write_db_meta(const char *path, uint32_t version) {
+    db_meta_t meta = { DB_META_MAGIC, version };
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
     if (fd < 0) return -1;
-    lock_file(fd);          // Full file lock to safely search
-    account_rec_t tmp;
-    long current_offset = 0;
-    long found_offset = -1;
-    while (read(fd, &tmp, sizeof(account_rec_t)) == sizeof(account_rec_t)) {
-        if (tmp.user_id == userId) {
-            found_offset = current_offset;
-            break; 
+    int rc = (pwrite(fd, &meta, sizeof(meta), 0) == sizeof(meta) && fsync(fd) == 0) ? 0 : -1;
+    close(fd);
+    return rc;
+}
+
+// Schema version on disk: meta.db if present, 1 for older dbs with data, 0 for a fresh db
+static uint32_t read_schema_version(void) {
+    db_meta_t meta;
+    int fd = open(META_DB_FILE, O_RDONLY);
+    if (fd >= 0) {
+        int ok = (pread(fd, &meta, sizeof(meta), 0) == sizeof(meta) && meta.magic == DB_META_MAGIC);
+        close(fd);
+        if (ok) return meta.schema_version;
+    }
+    struct stat st;
+    if ((stat(ACCOUNTS_DB_FILE, &st) == 0 && st.st_size > 0) || (stat(LOANS_DB_FILE, &st) == 0 && st.st_size > 0)) {
+        return 1;
+    }
+    return 0;
+}
+
+// Second half of the upgrade: install the converted copies, then the new meta.db
+static int finish_money_migration(void) {
+    if (rename(ACCOUNTS_MONEY_FILE, ACCOUNTS_DB_FILE) != 0 && errno != ENOENT) return -1;
+    if (rename(LOANS_MONEY_FILE, LOANS_DB_FILE) != 0 && errno != ENOENT) return -1;
+    return rename(META_MIGRATING_FILE, META_DB_FILE);
+}
+
+// Schema 1 -> 2: double balances/amounts become money_t minor units
+static int migrate_money_units(void) {
+    if (convert_db_file(ACCOUNTS_DB_FILE, ACCOUNTS_MONEY_FILE, sizeof(account_rec_t), convert_account_v1) != 0 ||
+        convert_db_file(LOANS_DB_FILE, LOANS_MONEY_FILE, sizeof(loan_rec_t), convert_loan_v1) != 0 ||
+        write_db_meta(META_MIGRATING_FILE, DB_SCHEMA_VERSION) != 0) {
+        unlink(ACCOUNTS_MONEY_FILE);
+        unlink(LOANS_MONEY_FILE);
+        unlink(META_MIGRATING_FILE);
+        return -1;
+    }
+    if (finish_money_migration() != 0) return -1;
+    printf("Migrated %s and %s to fixed-point money (schema %d).\n", ACCOUNTS_DB_FILE, LOANS_DB_FILE, DB_SCHEMA_VERSION);
+    return 0;
+}
+
+// Zero the redo stamp of every record in 'path' (a missing file is left alone)
+static int zero_redo_stamps(const char *path, size_t rec_sz, size_t stamp_off) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    lock_file(fd);
+    char rec[512];
+    const uint32_t zero = 0;
+    int rc = 0;
+    for (off_t pos = 0; rc == 0 && pread(fd, rec, rec_sz, pos) == (ssize_t)rec_sz; pos += rec_sz) {
+        if (memcmp(rec + stamp_off, &zero, sizeof(zero)) != 0 &&
+            pwrite(fd, &zero, sizeof(zero), pos + (off_t)stamp_off) != sizeof(zero)) {
+            rc = -1;
         }
-        current_offset += sizeof(account_rec_t); 
     }
+    if (rc == 0 && fsync(fd) != 0) rc = -1;
     unlock_file(fd);
     close(fd);
-    return found_offset;
+    return rc;
+}
+
+// Schema 2 -> 3: redo stamps start out as "never written by a redo entry"
+static int migrate_redo_stamps(void) {
+    if (zero_redo_stamps(ACCOUNTS_DB_FILE, sizeof(account_rec_t), offsetof(account_rec_t, redo_seq)) != 0 ||
+        zero_redo_stamps(LOANS_DB_FILE, sizeof(loan_rec_t), offsetof(loan_rec_t, redo_seq)) != 0 ||
+        write_db_meta(META_DB_FILE, DB_SCHEMA_VERSION) != 0) {
+        return -1;
+    }
+    printf("Migrated %s and %s to schema %d (redo stamps).\n", ACCOUNTS_DB_FILE, LOANS_DB_FILE, DB_SCHEMA_VERSION);
+    return 0;
+}
+
+static int migrate_schema(void) {
+    if (access(META_MIGRATING_FILE, F_OK) == 0 && finish_money_migration() != 0) return -1;
+    uint32_t version = read_schema_version();
+    if (version > DB_SCHEMA_VERSION) {
+        fprintf(stderr, "%s: schema %u is newer than this build (%d)\n", META_DB_FILE, version, DB_SCHEMA_VERSION);
+        return -1;
+    }
+    if (version == 0) return write_db_meta(META_DB_FILE, DB_SCHEMA_VERSION);
+    if (version < 2) return migrate_money_units();     // Converted records start with zeroed stamps
+    if (version < 3) return migrate_redo_stamps();
+    return 0;
+}
+
+// One-time on-disk format migrations (run from server_init before indexes are built)
+int migrate_db_files(void) {
+    if (migrate_accounts_layout() != 0) {
+        fprintf(stderr, "Failed to migrate %s\n", ACCOUNTS_DB_FILE);
+        return -1;
+    }
+    if (txn_log_convert_legacy() != 0) {
+        fprintf(stderr, "Failed to migrate %s\n", TRANSACTIONS_DB_FILE);
+        return -1;
+    }
+    if (migrate_schema() != 0) {
+        fprintf(stderr, "Failed to migrate %s\n", META_DB_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * --- MMAP ACCOUNT TABLE (Lock-free balance reads via per-slot seqlock) ---
+ * accounts.db is mapped MAP_SHARED into a fixed virtual reservation so the file can
+ * grow without moving the mapping. Readers copy a slot between two loads of its
+ * sequence counter (odd = write in progress) and never lock or make a syscall.
+ * Writers serialize per slot through the table record lock and bump the counter
+ * around the store. In balance log mode (balance_log.c) balances live in a parallel
+ * in-memory array and a store only touches the file when the identity or status changes.
+ */
+#define ACCOUNT_MAP_RESERVE_SLOTS (1u << 24)    // Address space reserved: 16M accounts
+#define ACCOUNT_MAP_GROW_SLOTS 4096             // File grows in page-aligned chunks of slots
+
+static account_rec_t *account_map = NULL;
+static _Atomic uint32_t *account_seq = NULL;
+static money_t *account_balance = NULL;         // Log mode: live balances, by slot
+static int account_balance_in_memory = 0;
+static _Atomic size_t account_map_slots = 0;    // Slots currently backed by the file
+static int account_map_fd = -1;
+static pthread_mutex_t account_grow_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t account_map_once = PTHREAD_ONCE_INIT;
+
+// Map more of the file so at least 'min_slots' slots are addressable (caller holds grow lock)
+static int account_map_extend(size_t min_slots) {
+    struct stat st;
+    if (fstat(account_map_fd, &st) != 0) return 0;
+    size_t mapped = atomic_load(&account_map_slots);
+    size_t want = (size_t)st.st_size / sizeof(account_rec_t);
+    if (want < min_slots) want = min_slots;
+    want = (want + ACCOUNT_MAP_GROW_SLOTS - 1) / ACCOUNT_MAP_GROW_SLOTS * ACCOUNT_MAP_GROW_SLOTS;
+    if (want <= mapped) return 1;
+    if (want > ACCOUNT_MAP_RESERVE_SLOTS) return 0;
+
+    off_t want_bytes = (off_t)(want * sizeof(account_rec_t));
+    if (st.st_size < want_bytes && ftruncate(account_map_fd, want_bytes) != 0) return 0;
+    off_t mapped_bytes = (off_t)(mapped * sizeof(account_rec_t));
+    void *tail = mmap((char *)account_map + mapped_bytes, want_bytes - mapped_bytes,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, account_map_fd, mapped_bytes);
+    if (tail == MAP_FAILED) return 0;
+    atomic_store(&account_map_slots, want);
+    return 1;
+}
+
+static void account_map_init(void) {
+    account_map_fd = db_table_fd(DB_ACCOUNTS);
+    if (account_map_fd < 0) return;
+    void *base = mmap(NULL, (size_t)ACCOUNT_MAP_RESERVE_SLOTS * sizeof(account_rec_t), PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void *seq = mmap(NULL, (size_t)ACCOUNT_MAP_RESERVE_SLOTS * sizeof(uint32_t), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED || seq == MAP_FAILED) {
+        perror("mmap accounts");
+        return;
+    }
+    account_map = base;
+    account_seq = seq;
+    pthread_mutex_lock(&account_grow_lock);
+    if (!account_map_extend(0)) perror("map accounts.db");
+    pthread_mutex_unlock(&account_grow_lock);
+}
+
+// Map accounts.db once per process (called from server_init; lazily elsewhere)
+int init_account_map(void) {
+    pthread_once(&account_map_once, account_map_init);
+    return (account_map != NULL && account_map_fd >= 0) ? 0 : -1;
+}
+
+// Slot index for an account, growing the mapping up to 'grow' slots if needed (-1 if unusable)
+static long account_slot_index(uint32_t accountId, int grow) {
+    long offset = account_slot_offset(accountId);
+    if (offset < 0 || init_account_map() != 0) return -1;
+    size_t idx = (size_t)offset / sizeof(account_rec_t);
+    if (idx >= atomic_load_explicit(&account_map_slots, memory_order_acquire)) {
+        // Slot past the mapping: the file may have grown (another process) or must grow (new account)
+        pthread_mutex_lock(&account_grow_lock);
+        int ok = account_map_extend(grow ? idx + 1 : 0);
+        pthread_mutex_unlock(&account_grow_lock);
+        if (!ok || idx >= atomic_load(&account_map_slots)) return -1;
+    }
+    return (long)idx;
+}
+
+// Seqlock read: retry until a copy is taken with no writer in between
+static void account_slot_load(size_t idx, account_rec_t *out) {
+    uint32_t before, after;
+    do {
+        while ((before = atomic_load_explicit(&account_seq[idx], memory_order_acquire)) & 1) {
+            sched_yield();
+        }
+        memcpy(out, &account_map[idx], sizeof(account_rec_t));
+        if (account_balance_in_memory) out->balance = account_balance[idx];
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&account_seq[idx], memory_order_relaxed);
+    } while (before != after);
+}
+
+// Seqlock write (caller holds the slot's writer locks)
+static void account_slot_store(size_t idx, const account_rec_t *rec) {
+    uint32_t seq = atomic_load_explicit(&account_seq[idx], memory_order_relaxed);
+    atomic_store_explicit(&account_seq[idx], seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (!account_balance_in_memory) {
+        memcpy(&account_map[idx], rec, sizeof(account_rec_t));
+    } else {
+        account_balance[idx] = rec->balance;
+        account_rec_t *row = &account_map[idx];
+        if (row->account_id != rec->account_id || row->user_id != rec->user_id || row->active != rec->active ||
+            row->redo_seq != rec->redo_seq) {
+            row->account_id = rec->account_id;
+            row->user_id = rec->user_id;
+            row->active = rec->active;
+            row->redo_seq = rec->redo_seq;
+        }
+    }
+    atomic_store_explicit(&account_seq[idx], seq + 2, memory_order_release);
+}
+
+// Current record of a slot for its writer (caller holds the slot's writer locks)
+static account_rec_t account_slot_peek(size_t idx) {
+    account_rec_t rec = account_map[idx];
+    if (account_balance_in_memory) rec.balance = account_balance[idx];
+    return rec;
 }
 
 // Atomic R-M-W for accounts.db (Record-level lock - essential for financial ops)
 int atomic_update_account(uint32_t userId, int (*modifier)(account_rec_t *acc, void *data), void *modifier_data) {
-    long offset = find_account_offset(userId);
-    if (offset < 0) 
+    long idx = account_slot_index(userId, 0);
+    if (idx < 0) 
         return 0; 
-    
-    int fd = open(ACCOUNTS_DB_FILE, O_RDWR);
-    if (fd < 0) 
+
+    db_record_lock(DB_ACCOUNTS, userId, LOCK_EXCLUSIVE);
+    int success = 0;
+    account_rec_t tmp = account_slot_peek(idx);   // Stable: writers to this slot are excluded
+    if (tmp.account_id == userId && modifier(&tmp, modifier_data)) {
+        account_slot_store(idx, &tmp);
+        success = 1;
+    }
+    db_record_unlock(DB_ACCOUNTS, userId, LOCK_EXCLUSIVE);
+    return success;
+}
+
+// Single-account operation with its log row (deposit, withdrawal): the row is committed
+// (durable per the fsync policy) under the record lock before the new balance is stored,
+// so a failed append leaves the account as it was and nothing acknowledges it
+int atomic_update_account_logged(uint32_t userId, int (*modifier)(account_rec_t *acc, void *data), void *modifier_data,
+                                 txn_rec_t *tx) {
+    long idx = account_slot_index(userId, 0);
+    if (idx < 0)
+        return 0;
+
+    db_record_lock(DB_ACCOUNTS, userId, LOCK_EXCLUSIVE);
+    int result = 0;
+    account_rec_t tmp = account_slot_peek(idx);
+    if (tmp.account_id == userId && modifier(&tmp, modifier_data)) {
+        result = append_transaction(tx) ? 1 : -1;
+        if (result == 1) account_slot_store(idx, &tmp);
+    }
+    db_record_unlock(DB_ACCOUNTS, userId, LOCK_EXCLUSIVE);
+    return result;
+}
+
+/*
+ * --- REDO-LOGGED UPDATES (transfers, loan approvals) ---
+ * The change set (account images, loan image, log rows) is made durable in redo.db
+ * while every record lock is held; only then are the images written, each stamped with
+ * the entry's seq so recovery can tell whether a record already holds it. REDO_APPLIED
+ * is marked before the locks are dropped, and REDO_DONE once the log rows are committed.
+ */
+
+// Commit the change set, then write the account images (caller holds their record locks)
+static int account_redo_apply(const long *slots, account_rec_t *images, int n,
+                              const loan_rec_t *loan, const txn_rows_t *log, uint64_t *seq) {
+    redo_change_t change = { images, n, loan, log ? log->rows : NULL, log ? log->count : 0 };
+    if (!redo_commit(&change, seq)) return 0;
+    for (int i = 0; i < n; i++) {
+        images[i].redo_seq = (uint32_t)*seq;
+        account_slot_store(slots[i], &images[i]);
+    }
+    return 1;
+}
+
+// After the locks are dropped: commit the log rows (deferred to redo_checkpoint() if that
+// fails), then let redo.db start over if it is due
+static void account_redo_finish(uint64_t seq, const txn_rows_t *log) {
+    int64_t log_rows = txn_log_rows();
+    if (log == NULL || log->count == 0 || append_transactions(log->rows, log->count)) {
+        redo_mark(seq, REDO_DONE);
+    } else {
+        redo_defer_rows(seq, log->rows, log->count, log_rows < 0 ? 0 : (uint64_t)log_rows);
+    }
+    redo_checkpoint();
+}
+
+// Atomic R-M-W of two accounts (e.g. a transfer): both records are locked together and
+// the modifier edits copies, so either both balances change or neither does
+int atomic_update_account_pair(uint32_t firstId, uint32_t secondId,
+                               int (*modifier)(account_rec_t *first, account_rec_t *second, void *data), void *modifier_data,
+                               txn_rows_t *log) {
+    if (firstId == secondId) return 0;
+    long slots[2] = { account_slot_index(firstId, 0), account_slot_index(secondId, 0) };
+    if (slots[0] < 0 || slots[1] < 0)
         return 0;
 
-    if (lock_record(fd, offset, sizeof(account_rec_t)) != 0) {
-        close(fd); 
-        return 0;       // Lock failed
+    uint64_t ids[2] = { firstId, secondId };
+    lm_lock_record_set(DB_ACCOUNTS, ids, 2, LOCK_EXCLUSIVE);
+    int success = 0;
+    uint64_t seq = 0;
+    account_rec_t copies[2] = { account_slot_peek(slots[0]), account_slot_peek(slots[1]) };
+    if (copies[0].account_id == firstId && copies[1].account_id == secondId &&
+        modifier(&copies[0], &copies[1], modifier_data) && account_redo_apply(slots, copies, 2, NULL, log, &seq)) {
+        redo_mark(seq, REDO_APPLIED);
+        success = 1;
     }
+    lm_unlock_record_set(DB_ACCOUNTS, ids, 2, LOCK_EXCLUSIVE);
+    if (success) account_redo_finish(seq, log);
+    return success;
+}
+
+// Atomic R-M-W of one account against many (e.g. a batch payout): every record is locked
+// in one pass. others[i] is the copy of otherIds[i] (shared when an id repeats; NULL if
+// there is no such account); all copies are written back if the modifier returns 1.
+int atomic_update_account_batch(uint32_t srcId, const uint32_t *otherIds, int count,
+                                int (*modifier)(account_rec_t *src, account_rec_t **others, void *data), void *modifier_data,
+                                txn_rows_t *log) {
+    if (count < 1 || count > MAX_BATCH_TRANSFER_ITEMS) return 0;
+    long src_idx = account_slot_index(srcId, 0);
+    if (src_idx < 0)
+        return 0;
 
+    uint64_t ids[MAX_BATCH_TRANSFER_ITEMS + 1];
+    ids[0] = srcId;
+    for (int i = 0; i < count; i++) ids[i + 1] = otherIds[i];
+    account_rec_t copies[MAX_BATCH_TRANSFER_ITEMS + 1];
+    long slots[MAX_BATCH_TRANSFER_ITEMS + 1];
+    account_rec_t *others[MAX_BATCH_TRANSFER_ITEMS];
     int success = 0;
-    account_rec_t tmp;
-    
-    lseek(fd, offset, SEEK_SET); 
-    if (read(fd, &tmp, sizeof(account_rec_t)) == sizeof(account_rec_t)) {
-        if (modifier(&tmp, modifier_data)) {
-            lseek(fd, offset, SEEK_SET); 
-            if (write(fd, &tmp, sizeof(account_rec_t)) == sizeof(account_rec_t)) {
-                success = 1;
-            }
+    uint64_t seq = 0;
+
+    lm_lock_record_set(DB_ACCOUNTS, ids, count + 1, LOCK_EXCLUSIVE);
+    copies[0] = account_slot_peek(src_idx);
+    slots[0] = src_idx;
+    int n = 1;
+    for (int i = 0; i < count; i++) {
+        long idx = account_slot_index(otherIds[i], 0);
+        others[i] = NULL;
+        if (idx < 0) continue;
+        for (int j = 0; j < n && others[i] == NULL; j++) {
+            if (slots[j] == idx) others[i] = &copies[j];
         }
-    }   
-    unlock_record(fd, offset, sizeof(account_rec_t));
-    close(fd);
+        if (others[i] == NULL && account_map[idx].account_id == otherIds[i]) {
+            copies[n] = account_slot_peek(idx);
+            slots[n] = idx;
+            others[i] = &copies[n++];
+        }
+    }
+    if (copies[0].account_id == srcId && modifier(&copies[0], others, modifier_data) &&
+        account_redo_apply(slots, copies, n, NULL, log, &seq)) {
+        redo_mark(seq, REDO_APPLIED);
+        success = 1;
+    }
+    lm_unlock_record_set(DB_ACCOUNTS, ids, count + 1, LOCK_EXCLUSIVE);
+    if (success) account_redo_finish(seq, log);
     return success;
 }
 
-// Offset Finder for Loans
-static long find_loan_offset(uint64_t loanId) {
-    int fd = open(LOANS_DB_FILE, O_RDONLY);
-    if (fd < 0) return -1;
-    lock_file(fd); // Full file lock to safely search
-    loan_rec_t tmp;
-    long current_offset = 0;
-    long found_offset = -1;
-    while (read(fd, &tmp, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
-        if (tmp.loan_id == loanId) {
-            found_offset = current_offset;
-            break; 
-        }
-        current_offset += sizeof(loan_rec_t); 
+typedef struct {
+    int (*visit)(const loan_rec_t *loan, void *data);
+    void *data;
+    loan_index_field_t field;
+    uint64_t key;
+    int matched;
+} loan_visit_t;
+
+static uint64_t loan_field_value(const loan_rec_t *loan, loan_index_field_t field) {
+    switch (field) {
+        case LOAN_BY_STATUS:    return loan->status;
+        case LOAN_BY_ASSIGNEE:  return loan->assigned_to;
+        default:                return loan->user_id;
     }
-    unlock_file(fd);
-    close(fd);
-    return found_offset;
+}
+
+static int call_loan_visitor(const void *rec, void *data) {
+    loan_visit_t *v = data;
+    const loan_rec_t *loan = rec;
+    if (loan_field_value(loan, v->field) != v->key) return 1;
+    v->matched++;
+    return v->visit(loan, v->data);
+}
+
+// Visit every loan whose 'field' equals 'key' as of one snapshot, in loan id order, until
+// visit() returns 0. No lock is held while visiting, so visit() may update loans.
+int for_each_loan(loan_index_field_t field, uint64_t key, int (*visit)(const loan_rec_t *loan, void *data), void *data) {
+    table_catch_up(&loans_table);
+    if (db_table_fd(DB_LOANS) < 0) return -1;
+
+    // The id list and the snapshot are taken together, so they agree on every loan
+    table_index_lock(&loans_table, LOCK_SHARED);
+    table_snapshot_t snap = table_snapshot_begin_locked(&loans_table);
+    const id_list_t *list = id_multi_get(loan_index_for(field), key);
+    size_t count = list ? list->count : 0;
+    uint64_t *ids = count ? malloc(count * sizeof(uint64_t)) : NULL;
+    if (ids) memcpy(ids, list->ids, count * sizeof(uint64_t));
+    table_index_unlock(&loans_table);
+
+    loan_visit_t v = { visit, data, field, key, 0 };
+    if (ids) table_visit_keys_snapshot(&loans_table, &snap, ids, count, call_loan_visitor, &v);
+    table_snapshot_end(&loans_table, &snap);
+    free(ids);
+    return (count && !ids) ? -1 : v.matched;
 }
 
 // Atomic R-M-W for loans.db (Record-level lock)
 int atomic_update_loan(uint64_t loanId, int (*modifier)(loan_rec_t *loan, void *data), void *modifier_data) {
-    long offset = find_loan_offset(loanId);
-    if (offset < 0) return 0; // Not found
-    
-    int fd = open(LOANS_DB_FILE, O_RDWR);
-    if (fd < 0) return 0;
+    typed_modifier_t m = { .loan = modifier, .data = modifier_data };
+    return table_update(&loans_table, loanId, call_loan_modifier, &m);
+}
 
-    if (lock_record(fd, offset, sizeof(loan_rec_t)) != 0) {
-        close(fd); return 0; // Lock failed
-    }
+typedef struct {
+    int (*modifier)(loan_rec_t *loan, account_rec_t *acc, void *data);
+    void *data;
+    txn_rows_t *log;
+    uint32_t account_id;    // Record-locked by the wrapper (0 if not locked)
+    long slot;
+    account_rec_t before;   // Account as it was, to undo if the loan cannot be written
+    int changed;
+    uint64_t seq;
+    int applied;
+} loan_account_update_t;
 
-    int success = 0;
-    loan_rec_t tmp;
-    
-    lseek(fd, offset, SEEK_SET); 
-    if (read(fd, &tmp, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
-        if (modifier(&tmp, modifier_data)) {
-            lseek(fd, offset, SEEK_SET); 
-            if (write(fd, &tmp, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
-                success = 1;
-            }
-        }
-    }
+// Runs under the loan record lock: locks the applicant's account, then commits both images
+static int call_loan_account_modifier(void *rec, void *data) {
+    loan_account_update_t *u = data;
+    loan_rec_t *loan = rec;
+    u->account_id = loan->user_id;
+    db_record_lock(DB_ACCOUNTS, u->account_id, LOCK_EXCLUSIVE);
+    u->slot = account_slot_index(u->account_id, 0);
+    account_rec_t acc = { 0 };
+    if (u->slot >= 0) acc = account_slot_peek(u->slot);
+    int found = (u->slot >= 0 && acc.account_id == u->account_id);
+    u->before = acc;
+    if (!u->modifier(loan, found ? &acc : NULL, u->data)) return 0;
 
-    unlock_record(fd, offset, sizeof(loan_rec_t));
-    close(fd);
-    return success;
+    u->changed = found && memcmp(&acc, &u->before, sizeof(acc)) != 0;
+    if (!account_redo_apply(&u->slot, &acc, u->changed, loan, u->log, &u->seq)) return 0;
+    loan->redo_seq = (uint32_t)u->seq;     // Written by the engine once this returns
+    return 1;
 }
 
+static void loan_account_written(const void *rec, int written, void *data) {
+    (void)rec;
+    loan_account_update_t *u = data;
+    if (written) {
+        redo_mark(u->seq, REDO_APPLIED);
+        u->applied = 1;
+        return;
+    }
+    // The loan did not reach loans.db: put the account back and drop the entry
+    if (u->changed) account_slot_store(u->slot, &u->before);
+    redo_mark(u->seq, REDO_CANCELLED);
+}
+
+// Atomic R-M-W of a loan and its applicant's account (loan lock, then account lock).
+// acc is NULL if the account does not exist; rows in 'log' are committed with the change.
+int atomic_update_loan_account(uint64_t loanId, int (*modifier)(loan_rec_t *loan, account_rec_t *acc, void *data),
+                               void *modifier_data, txn_rows_t *log) {
+    loan_account_update_t u = { .modifier = modifier, .data = modifier_data, .log = log };
+    table_update_then(&loans_table, loanId, call_loan_account_modifier, loan_account_written, &u);
+    if (u.account_id != 0) db_record_unlock(DB_ACCOUNTS, u.account_id, LOCK_EXCLUSIVE);
+    if (u.applied) account_redo_finish(u.seq, log);
+    return u.applied;
+}
 
 /*
  * --- NON-ATOMIC PERSISTENCE HELPERS (Full-File Lock on Read/Write) ---
  */
-// Read account
+// Read account (Lock-free, syscall-free seqlock read of the mapped slot)
 int read_account(int userId, account_rec_t *acc) {
-    int fd = open(ACCOUNTS_DB_FILE, O_RDONLY);
-    if(fd < 0) return 0;
-    lock_file(fd); 
+    long idx = account_slot_index(userId, 0);
+    if (idx < 0) return 0;
     account_rec_t tmp;
-    int found = 0;
-    while(read(fd, &tmp, sizeof(account_rec_t)) == sizeof(account_rec_t)) {
-        if(tmp.user_id == userId) {
-            *acc = tmp;
-            found = 1;
-            break;
-        }
-    }
-    unlock_file(fd);
-    close(fd);
-    return found;
+    account_slot_load(idx, &tmp);
+    if (tmp.account_id != (uint32_t)userId) return 0;
+    *acc = tmp;
+    return 1;
 }
 
-// Write account (update existing or append)
+// Write account (into its slot; growing the file leaves zeroed, i.e. empty, slots)
 int write_account(account_rec_t *acc) {
-    int fd = open(ACCOUNTS_DB_FILE, O_RDWR | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd); // Full file lock
-    account_rec_t tmp;
-    off_t pos = 0;
-    int found = 0;
-    int success = 0;
-    while(read(fd, &tmp, sizeof(account_rec_t)) == sizeof(account_rec_t)) {
-        if(tmp.user_id == acc->user_id) {
-            lseek(fd, pos, SEEK_SET);
-            if (write(fd, acc, sizeof(account_rec_t)) == sizeof(account_rec_t)) { // 
-                success = 1;
-            }
-            found = 1;
-            break;
-        }
-        pos += sizeof(account_rec_t);
+    long idx = account_slot_index(acc->account_id, 1);
+    if (idx < 0) return 0;
+    db_record_lock(DB_ACCOUNTS, acc->account_id, LOCK_EXCLUSIVE);
+    account_slot_store(idx, acc);
+    db_record_unlock(DB_ACCOUNTS, acc->account_id, LOCK_EXCLUSIVE);
+    return 1;
+}
+
+// Every account in slot order (seqlock reads) until visit() returns 0; returns the count visited
+int for_each_account(int (*visit)(const account_rec_t *acc, void *data), void *data) {
+    if (init_account_map() != 0) return -1;
+    size_t slots = atomic_load(&account_map_slots);
+    int visited = 0;
+    for (size_t idx = 0; idx < slots; idx++) {
+        account_rec_t acc;
+        account_slot_load(idx, &acc);
+        if (acc.account_id == ACCOUNT_SLOT_EMPTY) continue;
+        visited++;
+        if (!visit(&acc, data)) break;
     }
-    if (!found) { 
-        lseek(fd, 0, SEEK_END);
-        if (write(fd, acc, sizeof(account_rec_t)) == sizeof(account_rec_t)) { // 
-            success = 1;
-        }
+    return visited;
+}
+
+// Overwrite one balance (balance recovery at startup); 0 if there is no such account
+int set_account_balance(uint32_t accountId, money_t balance) {
+    long idx = account_slot_index(accountId, 0);
+    if (idx < 0) return 0;
+    db_record_lock(DB_ACCOUNTS, accountId, LOCK_EXCLUSIVE);
+    account_rec_t rec = account_slot_peek(idx);
+    int found = (rec.account_id == accountId);
+    if (found) {
+        rec.balance = balance;
+        account_slot_store(idx, &rec);
     }
-    unlock_file(fd);
-    close(fd);
+    db_record_unlock(DB_ACCOUNTS, accountId, LOCK_EXCLUSIVE);
+    return found;
+}
+
+// Balance log mode: from here on balances change only in memory and accounts.db keeps
+// the values it holds now (call before any client is served)
+int account_balances_to_memory(void) {
+    if (init_account_map() != 0) return 0;
+    if (account_balance_in_memory) return 1;
+    void *mem = mmap(NULL, (size_t)ACCOUNT_MAP_RESERVE_SLOTS * sizeof(money_t), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) return 0;
+    account_balance = mem;
+    size_t slots = atomic_load(&account_map_slots);
+    for (size_t idx = 0; idx < slots; idx++) account_balance[idx] = account_map[idx].balance;
+    account_balance_in_memory = 1;
     return 1;
 }
 
-// Read user
-int read_user(int userId, user_rec_t *user) {
-    int fd = open(USERS_DB_FILE, O_RDONLY);
-    if(fd < 0) return 0;
-    lock_file(fd); // Full file lock
-    user_rec_t tmp;
-    int found = 0;
-    while(read(fd, &tmp, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-        if(tmp.user_id == userId) {
-            *user = tmp;
-            found = 1;
-            break;
-        }
+// Make accounts.db hold the current balances and sync it (log mode copies them in first)
+int account_balances_flush(void) {
+    if (init_account_map() != 0) return 0;
+    size_t slots = atomic_load(&account_map_slots);
+    for (size_t idx = 0; account_balance_in_memory && idx < slots; idx++) {
+        uint32_t id = account_map[idx].account_id;
+        if (id == ACCOUNT_SLOT_EMPTY) continue;
+        db_record_lock(DB_ACCOUNTS, id, LOCK_EXCLUSIVE);
+        account_map[idx].balance = account_balance[idx];
+        db_record_unlock(DB_ACCOUNTS, id, LOCK_EXCLUSIVE);
     }
-    unlock_file(fd);
-    close(fd);
-    return found;
+    return msync(account_map, slots * sizeof(account_rec_t), MS_SYNC) == 0;
 }
 
-// Write user (update existing or append)
+// Sync accounts.db as it is mapped (log mode: balances are rebuilt from transactions.db
+// at startup, so the stale ones in the file are left alone)
+int account_map_sync(void) {
+    if (init_account_map() != 0) return 0;
+    size_t slots = atomic_load(&account_map_slots);
+    return msync(account_map, slots * sizeof(account_rec_t), MS_SYNC) == 0;
+}
+
+// Read user (Index lookup + record-level lock)
+int read_user(int userId, user_rec_t *user) {
+    return table_read(&users_table, (uint32_t)userId, user);
+}
+
+// Write user (update existing in place or append; the hooks keep the user indexes current)
 int write_user(user_rec_t *user) {
-    int fd = open(USERS_DB_FILE, O_RDWR | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd); // Full file lock
-    user_rec_t tmp;
-    off_t pos = 0;
-    int found = 0;
-    int success = 0;
-    while(read(fd, &tmp, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-        if(tmp.user_id == user->user_id) {
-            lseek(fd, pos, SEEK_SET);
-            if(write(fd, user, sizeof(user_rec_t)) == sizeof(user_rec_t)) { // 
-                success = 1;
-            }
-            found = 1;
-            break;
-        }
-        pos += sizeof(user_rec_t);
-    }
-    if (!found) { 
-        lseek(fd, 0, SEEK_END);
-        if(write(fd, user, sizeof(user_rec_t)) == sizeof(user_rec_t)) { // 
-            success = 1;
-        }
-    }
-    unlock_file(fd);
-    close(fd);
-    return 1;
+    return table_write(&users_table, user);
 }
 
-// Append transaction
+// Append transaction (group-committed by the txn log writer; durable on return)
 int append_transaction(txn_rec_t *tx) {
-    int fd = open(TRANSACTIONS_DB_FILE, O_WRONLY | O_APPEND | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd); // Full file lock
-    tx->txn_id = lseek(fd, 0, SEEK_END) / sizeof(txn_rec_t) + 1;
-    int success = (write(fd, tx, sizeof(txn_rec_t)) == sizeof(txn_rec_t)); //
-    unlock_file(fd);
-    close(fd);
-    return 1;
+    return txn_log_append(tx);
 }
 
-// Read loan
+// Several rows that must land together (e.g. both legs of a transfer)
+int append_transactions(txn_rec_t *txs, int count) {
+    return txn_log_append_all(txs, count);
+}
+
+// Read loan (Index lookup + record-level lock)
 int read_loan(uint64_t loanId, loan_rec_t *loan) {
-    int fd = open(LOANS_DB_FILE, O_RDONLY);
-    if(fd < 0) return 0;
-    lock_file(fd);
-    loan_rec_t tmp;
-    int found = 0;
-    while(read(fd, &tmp, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
-        if(tmp.loan_id == loanId) {
-            *loan = tmp;
-            found = 1;
-            break;
-        }
-    }
-    unlock_file(fd);
-    close(fd);
-    return found;
+    return table_read(&loans_table, loanId, loan);
 }
 
-// Write loan (update existing or append)
+// Write loan (update existing in place or append; the hooks keep the loan indexes current)
 int write_loan(loan_rec_t *loan) {
-    int fd = open(LOANS_DB_FILE, O_RDWR | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd);
-    loan_rec_t tmp;
-    off_t pos = 0;
-    int found = 0;
-    int success = 0;
-    while(read(fd, &tmp, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) {
-        if(tmp.loan_id == loan->loan_id) {
-            lseek(fd, pos, SEEK_SET);
-            if (write(fd, loan, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) { // 
-                success = 1;
-            }
-            found = 1;
-            break;
-        }
-        pos += sizeof(loan_rec_t);
-    }
-    if (!found) {
-        lseek(fd, 0, SEEK_END);
-        if (write(fd, loan, sizeof(loan_rec_t)) == sizeof(loan_rec_t)) { // 
-            success = 1;
-        }
-    }
-    unlock_file(fd);
-    close(fd);
-    return 1;
+    return table_write(&loans_table, loan);
+}
+
+// loan_id / fb_id are the 1-based row
+static void assign_loan_id(void *rec, uint64_t row) {
+    ((loan_rec_t *)rec)->loan_id = row + 1;
+}
+
+static void assign_feedback_id(void *rec, uint64_t row) {
+    ((feedback_rec_t *)rec)->fb_id = row + 1;
 }
 
 // Append loan
 int append_loan(loan_rec_t *loan) {
-    int fd = open(LOANS_DB_FILE, O_WRONLY | O_APPEND | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd);
-    loan->loan_id = lseek(fd, 0, SEEK_END) / sizeof(loan_rec_t) + 1;
-    int success = (write(fd, loan, sizeof(loan_rec_t)) == sizeof(loan_rec_t)); 
-    unlock_file(fd);
-    close(fd);
-    return 1;
+    return table_append(&loans_table, loan, assign_loan_id);
 }
 
-// Append feedback
-int append_feedback(feedback_rec_t *fb) {
-    int fd = open(FEEDBACK_DB_FILE, O_WRONLY | O_APPEND | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd);
-    fb->fb_id = lseek(fd, 0, SEEK_END) / sizeof(feedback_rec_t) + 1;
-    int success = (write(fd, fb, sizeof(feedback_rec_t)) == sizeof(feedback_rec_t));
-    unlock_file(fd);
-    close(fd);
+/*
+ * --- FEEDBACK TABLE + REVIEW QUEUE (Persisted watermark + in-memory FIFO) ---
+ * fb_id is always row + 1, so feedback.db is a dense table with no primary index.
+ * Every row below the watermark (feedback_review.db) is known to be reviewed, so the
+ * engine's build starts there and its insert hook queues the unreviewed rows; a review
+ * pass drains the FIFO and writes the flags back with one pwrite per run of adjacent
+ * rows. The queue is guarded by the table's index write lock.
+ */
+#define FEEDBACK_REVIEW_RUN_MAX 64
+
+static uint64_t *feedback_queue = NULL;     // Ring buffer of pending rows, oldest first
+static size_t feedback_queue_head = 0;
+static size_t feedback_queue_count = 0;
+static size_t feedback_queue_cap = 0;
+static uint64_t feedback_watermark = 0;     // Persisted copy of the watermark
+
+static int feedback_queue_push(uint64_t row) {
+    if (feedback_queue_count == feedback_queue_cap) {
+        size_t cap = feedback_queue_cap ? feedback_queue_cap * 2 : 64;
+        uint64_t *grown = malloc(cap * sizeof(uint64_t));
+        if (grown == NULL) return 0;
+        for (size_t i = 0; i < feedback_queue_count; i++) {
+            grown[i] = feedback_queue[(feedback_queue_head + i) % feedback_queue_cap];
+        }
+        free(feedback_queue);
+        feedback_queue = grown;
+        feedback_queue_cap = cap;
+        feedback_queue_head = 0;
+    }
+    feedback_queue[(feedback_queue_head + feedback_queue_count) % feedback_queue_cap] = row;
+    feedback_queue_count++;
     return 1;
 }
 
-// Write feedback
-int write_feedback(feedback_rec_t *fb) {
-    int fd = open(FEEDBACK_DB_FILE, O_RDWR | O_CREAT, 0666);
-    if(fd < 0) return 0;
-    lock_file(fd);
-    feedback_rec_t tmp;
-    off_t pos = 0;
-    int found = 0;
-    int success = 0;
-    while(read(fd, &tmp, sizeof(feedback_rec_t)) == sizeof(feedback_rec_t)) {
-        if(tmp.fb_id == fb->fb_id) {
-            lseek(fd, pos, SEEK_SET);
-            if(write(fd, fb, sizeof(feedback_rec_t)) == sizeof(feedback_rec_t)) { // 
-                success = 1;
-            }
-            found = 1;
-            break;
-        }
-        pos += sizeof(feedback_rec_t);
+static uint64_t feedback_queue_pop(void) {
+    uint64_t row = feedback_queue[feedback_queue_head];
+    feedback_queue_head = (feedback_queue_head + 1) % feedback_queue_cap;
+    feedback_queue_count--;
+    return row;
+}
+
+static void feedback_watermark_store(uint64_t row) {
+    int wfd = db_table_fd(DB_FEEDBACK_WATERMARK);
+    if (wfd >= 0 && pwrite(wfd, &row, sizeof(row), 0) == sizeof(row)) {
+        feedback_watermark = row;
+    }
+}
+
+static uint64_t feedback_key(const void *rec) {
+    return ((const feedback_rec_t *)rec)->fb_id;
+}
+
+// Build hook: the engine starts indexing at the persisted watermark
+static uint64_t feedback_build_from(void) {
+    uint64_t watermark = 0;
+    int wfd = db_table_fd(DB_FEEDBACK_WATERMARK);
+    if (wfd < 0 || pread(wfd, &watermark, sizeof(watermark), 0) != sizeof(watermark)) watermark = 0;
+    feedback_watermark = watermark;
+    return watermark;
+}
+
+// Index hook: queue every unreviewed row as it is indexed
+static void feedback_queue_insert(const void *rec, uint64_t row) {
+    if (((const feedback_rec_t *)rec)->reviewed == 0) feedback_queue_push(row);
+}
+
+// Index hook: a re-opened feedback is queued again, and the watermark kept below it
+static void feedback_queue_reopen(const void *old_rec, const void *new_rec) {
+    const feedback_rec_t *old = old_rec, *updated = new_rec;
+    if (old->reviewed && !updated->reviewed) {
+        uint64_t row = updated->fb_id - 1;
+        feedback_queue_push(row);
+        if (row < feedback_watermark) feedback_watermark_store(row);
     }
-    if (!found) {
-        lseek(fd, 0, SEEK_END);
-        if(write(fd, fb, sizeof(feedback_rec_t)) == sizeof(feedback_rec_t)) { // 
-            success = 1;
+}
+
+static record_table_t feedback_table = {
+    .table = DB_FEEDBACK,
+    .rec_size = sizeof(feedback_rec_t),
+    .key_of = feedback_key,
+    .dense = 1,
+    .hooks = { .on_insert = feedback_queue_insert, .on_update = feedback_queue_reopen, .build_from = feedback_build_from },
+    .index_lock = PTHREAD_RWLOCK_INITIALIZER,
+    .versions_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+// Review pass: visits each unreviewed feedback oldest first, marks it reviewed and
+// advances the watermark. Returns the number reviewed (-1 if feedback.db is unusable).
+int review_pending_feedback(void (*visit)(const feedback_rec_t *fb, void *data), void *data) {
+    if (db_table_fd(DB_FEEDBACK) < 0) return -1;
+    table_catch_up(&feedback_table);    // Rows appended by another process
+    db_table_lock(DB_FEEDBACK, LOCK_EXCLUSIVE);
+    table_index_lock(&feedback_table, LOCK_EXCLUSIVE);
+
+    feedback_rec_t run[FEEDBACK_REVIEW_RUN_MAX];
+    uint64_t run_start = 0;
+    uint64_t unwritten = UINT64_MAX;     // Oldest row whose flag could not be written
+    int run_len = 0, reviewed = 0;
+    size_t pending = feedback_queue_count;
+    for (size_t n = 0; n <= pending; n++) {
+        uint64_t row = (n < pending) ? feedback_queue_pop() : UINT64_MAX;
+        if (run_len > 0 && (row != run_start + run_len || run_len == FEEDBACK_REVIEW_RUN_MAX)) {
+            if (!table_put_rows(&feedback_table, run_start, run, run_len)) {
+                for (int i = 0; i < run_len; i++) feedback_queue_push(run_start + i);
+                if (run_start < unwritten) unwritten = run_start;
+                reviewed -= run_len;
+            }
+            run_len = 0;
         }
+        if (n == pending) break;
+        feedback_rec_t *fb = &run[run_len];
+        if (!table_get_row(&feedback_table, row, fb) || fb->reviewed) continue;
+        if (run_len == 0) run_start = row;
+        visit(fb, data);
+        fb->reviewed = 1;
+        run_len++;
+        reviewed++;
     }
-    unlock_file(fd);
-    close(fd);
-    return 1;
+
+    uint64_t watermark = (unwritten != UINT64_MAX) ? unwritten : feedback_table.covered;
+    if (watermark != feedback_watermark) feedback_watermark_store(watermark);
+    table_index_unlock(&feedback_table);
+    db_table_unlock(DB_FEEDBACK, LOCK_EXCLUSIVE);
+    return reviewed;
+}
+
+// Append feedback (the insert hook queues it for review)
+int append_feedback(feedback_rec_t *fb) {
+    return table_append(&feedback_table, fb, assign_feedback_id);
+}
+
+// Write feedback (in place; a re-opened one is queued again by the update hook)
+int write_feedback(feedback_rec_t *fb) {
+    return table_write(&feedback_table, fb);
 }
 
 // Read feedback (by ID)
 int read_feedback(uint64_t fbId, feedback_rec_t *fb) {
-    int fd = open(FEEDBACK_DB_FILE, O_RDONLY);
-    if(fd < 0) return 0;
-    lock_file(fd);
-    feedback_rec_t tmp;
-    int found = 0;
-    while(read(fd, &tmp, sizeof(feedback_rec_t)) == sizeof(feedback_rec_t)) {
-        if(tmp.fb_id == fbId) {
-            *fb = tmp;
-            found = 1;
-            break;
-        }
-    }
-    unlock_file(fd);
-    close(fd);
-    return found;
+    return table_read(&feedback_table, fbId, fb);
+}
+
+typedef struct {
+    int (*user)(const user_rec_t *user, void *data);
+    int (*feedback)(const feedback_rec_t *fb, void *data);
+    void *data;
+} typed_visitor_t;
+
+static int call_user_visitor(const void *rec, uint64_t row, void *data) {
+    typed_visitor_t *v = data;
+    (void)row;
+    return v->user((const user_rec_t *)rec, v->data);
+}
+
+static int call_feedback_visitor(const void *rec, uint64_t row, void *data) {
+    typed_visitor_t *v = data;
+    (void)row;
+    return v->feedback((const feedback_rec_t *)rec, v->data);
+}
+
+// Users as of one snapshot, in file order, until visit() returns 0 (writers are not blocked)
+int for_each_user(int (*visit)(const user_rec_t *user, void *data), void *data) {
+    typed_visitor_t v = { .user = visit, .data = data };
+    table_catch_up(&users_table);
+    table_snapshot_t snap = table_snapshot_begin(&users_table);
+    int visited = table_scan_snapshot(&users_table, &snap, call_user_visitor, &v);
+    table_snapshot_end(&users_table, &snap);
+    return visited;
+}
+
+// Range scan in file order until visit() returns 0 (table held shared)
+
+int for_each_feedback(int (*visit)(const feedback_rec_t *fb, void *data), void *data) {
+    typed_visitor_t v = { .feedback = visit, .data = data };
+    return table_scan(&feedback_table, 0, call_feedback_visitor, &v);
 }
 
 // Simple unique ID generation (Atomic: Full-file lock + lseek)
 int generate_new_userId() {
-    int fd = open(USERS_DB_FILE, O_RDONLY | O_CREAT, 0666);
-    if (fd < 0) 
-        return 1001;    // Start from 1001 if file can't be opened
-    lock_file(fd);
-    int count = lseek(fd, 0, SEEK_END) / sizeof(user_rec_t);
-    unlock_file(fd);
-    close(fd);
-    return 1001 + count;    // Start IDs from 1001
+    if (db_table_fd(DB_USERS) < 0) 
+        return USER_ID_BASE;    // Start from 1001 if file can't be opened
+    db_table_lock(DB_USERS, LOCK_SHARED);
+    int count = (int)table_row_count(&users_table);
+    db_table_unlock(DB_USERS, LOCK_SHARED);
+    return USER_ID_BASE + count;    // Start IDs from 1001
 }
 
-// Checks for unique username/email/phone (Concurrency: Full-file lock for atomicity)
-int check_uniqueness(const char* username, const char* email, const char* phone, uint32_t current_user_id, char* resp_msg, size_t resp_sz) {
-    int fd = open(USERS_DB_FILE, O_RDONLY);
-    if (fd < 0) {   // Unable to open file, assume unique
-        return 1;
-    }
-    
-    lock_file(fd);      // Lock the file for a consistent read
-    user_rec_t user;
+// Pending owners for new users: -2, -3, ... (-1 is str_index_get's "absent")
+int64_t new_user_ticket(void) {
+    static _Atomic int64_t last_ticket = -1;
+    return atomic_fetch_sub(&last_ticket, 1) - 1;
+}
+
+// Checks for unique username/email/phone and reserves them for 'owner' (O(1) probes,
+// all-or-nothing). Any key held by someone else, reserved or written, is a conflict.
+// New users pass a new_user_ticket(); the reservation becomes theirs in write_user or
+// must be dropped with release_user_keys. Updates commit/release via atomic_update_user.
+int check_uniqueness(const char* username, const char* email, const char* phone, int64_t owner, char* resp_msg, size_t resp_sz) {
+    table_catch_up(&users_table);   // Keys written by another process must count too
+    table_index_lock(&users_table, LOCK_EXCLUSIVE);
+    int64_t held;
     int is_unique = 1;
 
-    while (read(fd, &user, sizeof(user_rec_t)) == sizeof(user_rec_t)) {
-        if (user.user_id == current_user_id) {
-            continue;       // Skip self-check when modifying
-        }
+    if ((held = str_index_get(&username_index, username)) != -1 && held != owner) {
+        snprintf(resp_msg, resp_sz, "Error: Username '%s' already exists.", username);
+        is_unique = 0;
+    } else if ((held = str_index_get(&email_index, email)) != -1 && held != owner) {
+        snprintf(resp_msg, resp_sz, "Error: Email '%s' already exists.", email);
+        is_unique = 0;
+    } else if ((held = str_index_get(&phone_index, phone)) != -1 && held != owner) {
+        snprintf(resp_msg, resp_sz, "Error: Phone '%s' already exists.", phone);
+        is_unique = 0;
+    }
 
-        if (strcmp(user.username, username) == 0) {
-            snprintf(resp_msg, resp_sz, "Error: Username '%s' already exists.", username);
-            is_unique = 0;
-            break;
-        }
-        if (strcmp(user.email, email) == 0) {
-            snprintf(resp_msg, resp_sz, "Error: Email '%s' already exists.", email);
-            is_unique = 0;
-            break;
-        }
-        if (strcmp(user.phone, phone) == 0) {
-            snprintf(resp_msg, resp_sz, "Error: Phone '%s' already exists.", phone);
-            is_unique = 0;
-            break;
-        }
+    if (is_unique) {
+        str_index_put(&username_index, username, owner);
+        str_index_put(&email_index, email, owner);
+        str_index_put(&phone_index, phone, owner);
     }
-    
-    unlock_file(fd);
-    close(fd);
+    table_index_unlock(&users_table);
     return is_unique;
-}
\ No newline at end of file
+}